@@ -0,0 +1,147 @@
+//==============================================================================
+//
+//                   Arena - the node tree allocator
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//==============================================================================
+
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <algorithm>
+
+#include "Arena.h"
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+
+namespace gpx
+{
+  Arena::Arena() :
+    _blocks(),
+    _top(nullptr),
+    _left(0),
+    _capacity(0),
+    _names()
+  {
+  }
+
+  Arena::~Arena()
+  {
+    for (std::vector<char*>::iterator iter = _blocks.begin(); iter != _blocks.end(); ++iter)
+      free(*iter);
+  }
+
+  void *Arena::allocate(size_t size, size_t align)
+  {
+    size_t padding = (align - (reinterpret_cast<uintptr_t>(_top) & (align - 1))) & (align - 1);
+
+    if ((_top == nullptr) || (padding + size > _left))
+    {
+      // Oversized requests get their own block, the current one stays in use
+      size_t length = (size + align > ARENA_BLOCK_SIZE) ? size + align : ARENA_BLOCK_SIZE;
+
+      char *block = static_cast<char*>(malloc(length));
+
+      if (block == nullptr)
+      {
+        throw std::bad_alloc();
+      }
+
+      _blocks.push_back(block);
+      _capacity += length;
+
+      if (length != ARENA_BLOCK_SIZE)
+      {
+        return block + ((align - (reinterpret_cast<uintptr_t>(block) & (align - 1))) & (align - 1));
+      }
+
+      _top = block;
+      _left = length;
+
+      padding = (align - (reinterpret_cast<uintptr_t>(_top) & (align - 1))) & (align - 1);
+    }
+
+    void *p = _top + padding;
+
+    _top += padding + size;
+    _left -= padding + size;
+
+    return p;
+  }
+
+  const char *Arena::intern(const char *name)
+  {
+    std::unordered_set<std::string_view>::const_iterator iter = _names.find(name);
+
+    if (iter != _names.end())
+    {
+      return iter->data();
+    }
+
+    size_t capacity = 0;
+
+    std::string_view copy = append(std::string_view(), capacity, name, strlen(name));
+
+    _names.insert(copy);
+
+    return copy.data();
+  }
+
+  std::string_view Arena::append(std::string_view value, size_t &capacity, const char *text, size_t length)
+  {
+    char *p = const_cast<char*>(value.data());
+
+    size_t size = value.size() + length + 1;
+
+    // Last allocation: extend the reservation
+    if ((capacity > 0) && (size > capacity) && (p + capacity == _top) && (size - capacity <= _left))
+    {
+      _top += size - capacity;
+      _left -= size - capacity;
+
+      capacity = size;
+    }
+
+    // Grow in place (overwrite the nul terminator)
+    if (size <= capacity)
+    {
+      memcpy(p + value.size(), text, length);
+      p[value.size() + length] = '\0';
+
+      return std::string_view(p, value.size() + length);
+    }
+
+    capacity = std::max(size, 2 * capacity);
+
+    p = static_cast<char*>(allocate(capacity, 1));
+
+    if (!value.empty())
+    {
+      memcpy(p, value.data(), value.size());
+    }
+
+    if (length > 0)
+    {
+      memcpy(p + value.size(), text, length);
+    }
+
+    p[value.size() + length] = '\0';
+
+    return std::string_view(p, value.size() + length);
+  }
+}
@@ -73,7 +73,7 @@ namespace gpx
       {
         if (report != nullptr)
         {
-          report->report(this, Report::INCORRECT_VALUE, this->getValue());
+          report->report(this, Report::INCORRECT_VALUE, std::string(this->getValue()));
         }
 
         ok = false;
@@ -82,7 +82,7 @@ namespace gpx
       {
         if (report != nullptr)
         {
-          report->report(this, Report::INCORRECT_VALUE, this->getValue());
+          report->report(this, Report::INCORRECT_VALUE, std::string(this->getValue()));
         }
         ok = false;
       }
@@ -53,7 +53,7 @@ namespace gpx
       {
         if (report != nullptr)
         {
-          report->report(this, Report::INCORRECT_VALUE, this->getValue());
+          report->report(this, Report::INCORRECT_VALUE, std::string(this->getValue()));
         }
         ok = false;
       }
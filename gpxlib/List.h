@@ -54,22 +54,17 @@ namespace gpx
     /// @param  mandatory  is the attribute or element mandatory ?
     ///
     List(Node *parent, const char *name, Node::Type type, bool mandatory = false) :
-      Node(parent, name, type, mandatory)
+      Node(parent, name, type, mandatory),
+      _list(getArena())
     {
 
     }
 
     ///
-    /// Deconstructor
+    /// Deconstructor (the nodes are released with the arena)
     ///
     virtual ~List()
     {
-      while (!_list.empty())
-      {
-        delete _list.back();
-
-        _list.pop_back();
-      }
     }
 
     // Properties
@@ -79,7 +74,7 @@ namespace gpx
     ///
     /// @return the list
     ///
-    std::list<T*> &list() { return _list;}
+    std::list<T*, Arena::Allocator<T*> > &list() { return _list;}
 
 
     // Methods
@@ -107,7 +102,7 @@ namespace gpx
 
     virtual Node *insert(Node *before, Report *report = nullptr)
     {
-      T *node = new T(getParent(), getName().c_str(), getType(), isMandatory());
+      T *node = new (getArena()) T(getParent(), getName(), getType(), isMandatory());
 
       if (node->getParent() != 0)
       {
@@ -117,7 +112,7 @@ namespace gpx
       // Insert in private list
       if (before != nullptr)
       {
-        typename std::list<T*>::iterator iter = _list.begin();
+        typename std::list<T*, Arena::Allocator<T*> >::iterator iter = _list.begin();
         for (; iter != _list.end(); ++iter)
         {
           if ((*iter) == node)
@@ -154,17 +149,13 @@ namespace gpx
     {
       bool removed = false;
 
-      typename std::list<T*>::iterator iter = _list.begin();
+      typename std::list<T*, Arena::Allocator<T*> >::iterator iter = _list.begin();
       while (iter !=  _list.end())
       {
         if ((node == nullptr) || ((*iter) == node))
         {
-          Node *child = (*iter);
-
           iter = _list.erase(iter);
 
-          delete child;
-
           removed = true;
         }
         else
@@ -178,7 +169,7 @@ namespace gpx
 
     
     // Members
-    std::list<T*> _list;
+    std::list<T*, Arena::Allocator<T*> > _list;
     
     // Disable copy constructors
     List(const List &);
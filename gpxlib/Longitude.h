@@ -68,7 +68,7 @@ namespace gpx
     virtual bool validate(Report *report = nullptr) const;
     
 	operator double() const { 
-		return std::stod(this->getValue());
+		return std::stod(std::string(this->getValue()));
 	}
     
     private:
@@ -34,29 +34,30 @@ namespace gpx
 {
   Node::Node(Node *parent, const char *name, gpx::Node::Type type, bool mandatory) :
     _parent(parent),
-    _name(name),
+    _root(parent == nullptr ? new Arena() : nullptr),
+    _arena(parent == nullptr ? _root.get() : parent->getArena()),
+    _line(0),
+    _name(_arena->intern(name)),
     _type(type),
-    _value(),
-    _interfaces(),
-    _attributes(),
-    _elements(),
+    _value(""),
+    _capacity(0),
+    _interfaces(_arena),
+    _attributes(_arena),
+    _elements(_arena),
     _mandatory(mandatory)
   {
   }
 
   Node::~Node()
   {
-
-    for(std::list<Node*>::iterator it = _unknownElements.begin(); it != _unknownElements.end(); ++it)
-      delete *it;
-
+    // Child nodes are released with the arena (root node)
   }
 
   string Node::getTrimmedValue() const
   {
     const char *spaces = " \t\n\r\f\v";
 
-    string trimmed = getValue();
+    string trimmed(getValue());
 
     trimmed.erase(0, trimmed.find_first_not_of(spaces));
     trimmed.erase(trimmed.find_last_not_of(spaces)+1);
@@ -96,9 +97,9 @@ namespace gpx
 
   Node *Node::insert(Node *before, const char *name, Type type, Report *report)
   {
-    for (list<Node*>::iterator iter = _interfaces.begin(); iter != _interfaces.end(); ++iter)
+    for (Nodes::iterator iter = _interfaces.begin(); iter != _interfaces.end(); ++iter)
     {
-      if (strcasecmp(name, (*iter)->getName().c_str()) == 0)
+      if (strcasecmp(name, (*iter)->getName()) == 0)
       {
         return (*iter)->insert(before, report);
       }
@@ -111,12 +112,10 @@ namespace gpx
 
 
 
-    Node *node = new Node(this, name, type, false);
+    Node *node = new (_arena) Node(this, name, type, false);
     
     node->insert(before, report);
 
-    _unknownElements.push_back(node);
-
 
     return node;
   }
@@ -126,16 +125,16 @@ namespace gpx
   {
     setValue(source->getValue());
 
-    for (std::list<gpx::Node*>::iterator node = source->getAttributes().begin(); node != source->getAttributes().end(); ++node)
+    for (Nodes::iterator node = source->getAttributes().begin(); node != source->getAttributes().end(); ++node)
     {
-      gpx::Node *attribute = add((*node)->getName().c_str(), gpx::Node::ATTRIBUTE, report);
+      gpx::Node *attribute = add((*node)->getName(), gpx::Node::ATTRIBUTE, report);
 
       attribute->copy(*node, report);
     }
 
-    for (std::list<gpx::Node*>::iterator node = source->getElements().begin(); node != source->getElements().end(); ++node)
+    for (Nodes::iterator node = source->getElements().begin(); node != source->getElements().end(); ++node)
     {
-      gpx::Node *element = add((*node)->getName().c_str(), gpx::Node::ELEMENT, report);
+      gpx::Node *element = add((*node)->getName(), gpx::Node::ELEMENT, report);
 
       element->copy(*node, report);
     }
@@ -146,7 +145,7 @@ namespace gpx
   {
     bool ok = true;
 
-    for (list<Node*>::const_iterator iter = _interfaces.begin(); iter != _interfaces.end(); ++iter)
+    for (Nodes::const_iterator iter = _interfaces.begin(); iter != _interfaces.end(); ++iter)
     {
       if (((*iter)->isMandatory()) && (!(*iter)->used()))
       {
@@ -158,12 +157,12 @@ namespace gpx
       }
     }
     
-    for (list<Node*>::const_iterator iter = _attributes.begin(); iter != _attributes.end(); ++iter)
+    for (Nodes::const_iterator iter = _attributes.begin(); iter != _attributes.end(); ++iter)
     {
       ok &= (*iter)->validate(report);
     }
 
-    for (list<Node*>::const_iterator iter = _elements.begin(); iter != _elements.end(); ++iter)
+    for (Nodes::const_iterator iter = _elements.begin(); iter != _elements.end(); ++iter)
     {
       ok &= (*iter)->validate(report);
     }
@@ -175,7 +174,7 @@ namespace gpx
   {
     bool removed = false;
 
-    list<Node*>::iterator iter;
+    Nodes::iterator iter;
 
     iter = _attributes.begin();
     while (iter != _attributes.end())
@@ -235,11 +234,12 @@ namespace gpx
 
     if (_parent != nullptr)
     {
-      list<Node*> &nodes = (_type == ATTRIBUTE ? _parent->getAttributes() : _parent->getElements());
+      Nodes &nodes = (_type == ATTRIBUTE ? _parent->getAttributes() : _parent->getElements());
 
-      for (list<Node*>::const_iterator iter = nodes.begin(); iter != nodes.end(); ++iter)
+      for (Nodes::const_iterator iter = nodes.begin(); iter != nodes.end(); ++iter)
       {
-        if (strcasecmp(_name.c_str(), (*iter)->getName().c_str()) == 0)
+        // Interned names: same pointer for the same name
+        if (((*iter)->getName() == _name) || (strcasecmp(_name, (*iter)->getName()) == 0))
         {
           count++;
         }
@@ -253,11 +253,12 @@ namespace gpx
   {
     if (_parent != nullptr)
     {
-      list<Node*> &nodes = (_type == ATTRIBUTE ? _parent->getAttributes() : _parent->getElements());
+      Nodes &nodes = (_type == ATTRIBUTE ? _parent->getAttributes() : _parent->getElements());
 
-      for (list<Node*>::const_iterator iter = nodes.begin(); iter != nodes.end(); ++iter)
+      for (Nodes::const_iterator iter = nodes.begin(); iter != nodes.end(); ++iter)
       {
-        if (strcasecmp(_name.c_str(), (*iter)->getName().c_str()) == 0)
+        // Interned names: same pointer for the same name
+        if (((*iter)->getName() == _name) || (strcasecmp(_name, (*iter)->getName()) == 0))
         {
           return true;
         }
@@ -274,7 +275,7 @@ namespace gpx
     
     while (node != nullptr)
     {
-      if (strcasecmp(node->getName().c_str(), "extensions") == 0)
+      if (strcasecmp(node->getName(), "extensions") == 0)
       {
         return true;
       }
@@ -290,11 +291,11 @@ namespace gpx
     return (!_elements.empty());
   }
 
-  void Node::insert(Node *before, list<Node*> &nodes, Report *report)
+  void Node::insert(Node *before, Nodes &nodes, Report *report)
   {
     if (before != nullptr)
     {
-      list<Node*>::iterator node = nodes.begin();
+      Nodes::iterator node = nodes.begin();
 
       for (; node != nodes.end(); ++node)
       {
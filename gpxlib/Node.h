@@ -28,7 +28,9 @@
 //==============================================================================
 
 #include <string>
+#include <string_view>
 #include <list>
+#include <memory>
 
 #ifdef WIN32
 #ifndef strcasecmp
@@ -43,6 +45,7 @@
 #include <strings.h>
 #endif
 
+#include "Arena.h"
 #include "Report.h"
 
 
@@ -53,6 +56,9 @@ namespace gpx
   ///
   /// @brief The base node class.
   ///
+  /// A tree is owned by the arena of its root node: child nodes, lists,
+  /// names and values live in it, and are released together with the root.
+  ///
   
   class Node
   {
@@ -66,6 +72,11 @@ namespace gpx
       ATTRIBUTE,
       ELEMENT
     };
+
+    ///
+    /// Child nodes list
+    ///
+    typedef std::list<Node*, Arena::Allocator<Node*> > Nodes;
     
     ///
     /// Constructor
@@ -81,6 +92,15 @@ namespace gpx
     /// Deconstructor
     ///
     virtual ~Node();
+
+    ///
+    /// Allocate a node in an arena (never deleted, released with the arena)
+    ///
+    static void *operator new(size_t size, Arena *arena) { return arena->allocate(size); }
+    static void operator delete(void *, Arena *) { }
+
+    static void *operator new(size_t size) { return ::operator new(size); }
+    static void operator delete(void *p) { ::operator delete(p); }
     
     
     // Properties
@@ -88,9 +108,9 @@ namespace gpx
     ///
     /// Return the name
     ///
-    /// @return the name of the attribute or element
+    /// @return the name of the attribute or element (interned)
     ///
-    const std::string &getName() const { return _name; }
+    const char *getName() const { return _name; }
 
     ///
     /// Return the type
@@ -102,9 +122,9 @@ namespace gpx
     ///
     /// Return the value
     ///
-    /// @return the value of the attribute or element
+    /// @return the value of the attribute or element (nul terminated)
     ///
-    virtual const std::string &getValue() const { return _value; }
+    virtual std::string_view getValue() const { return _value; }
 
     ///
     /// Return the trimmed value
@@ -135,14 +155,14 @@ namespace gpx
     ///
     /// @param value   the value of the attribute or element
     ///
-    virtual void setValue(std::string value) { _value = value; }
+    virtual void setValue(std::string_view value) { _value = ""; _capacity = 0; appendValue(value); }
 
     ///
     /// Append to the value of the element
     ///
     /// @param value   the value to append to the attribute or element
     ///
-    virtual void appendValue(const std::string& value) { _value.append(value); }
+    virtual void appendValue(std::string_view value) { if (!value.empty()) _value = _arena->append(_value, _capacity, value.data(), value.size()); }
 
     ///
     /// Get the parent node of this node
@@ -151,27 +171,34 @@ namespace gpx
     ///
     Node *getParent() const { return _parent; }
 
+    ///
+    /// Get the arena owning this node
+    ///
+    /// @return the arena
+    ///
+    Arena *getArena() const { return _arena; }
+
     ///
     /// Get the interfaces list
     ///
     /// @return the interface list
     ///
     ///
-    std::list<Node*> &getInterfaces() { return _interfaces; }
+    Nodes &getInterfaces() { return _interfaces; }
 
     ///
     /// Get the attributes list
     ///
     /// @return the attributes list
     ///
-    std::list<Node*> &getAttributes() { return _attributes; }
+    Nodes &getAttributes() { return _attributes; }
     
     ///
     /// Get the elements list
     ///
     /// @return the elements list
     ///
-    std::list<Node*> &getElements() { return _elements; }
+    Nodes &getElements() { return _elements; }
         
     // Methods
     
@@ -295,7 +322,7 @@ namespace gpx
     /// @param  nodese    the list with nodes in which this node must be inserted
     /// @param  report    the optional report stream
     ///
-    void insert(Node *before, std::list<Node*> &nodes, Report *report = nullptr);
+    void insert(Node *before, Nodes &nodes, Report *report = nullptr);
 
   private:
 
@@ -310,14 +337,16 @@ namespace gpx
 
     // Members
     Node              *_parent;
+    std::unique_ptr<Arena> _root;
+    Arena             *_arena;
 	int                _line;
-    std::string        _name;
+    const char        *_name;
     Type               _type;
-    std::string        _value;
-    std::list<Node*>   _interfaces;
-    std::list<Node*>   _attributes;
-    std::list<Node*>   _elements;
-    std::list<Node*>   _unknownElements;
+    std::string_view   _value;
+    size_t             _capacity;
+    Nodes              _interfaces;
+    Nodes              _attributes;
+    Nodes              _elements;
     bool               _mandatory;
     
     // Do not implement
@@ -111,11 +111,11 @@ namespace gpx
     }
   }
 
-  void Parser::value(std::string value)
+  void Parser::value(const char *data, size_t length)
   {
     if (_current != nullptr)
     {
-      _current->appendValue(value);
+      _current->appendValue(std::string_view(data, length));
     }
     else if (_report != nullptr)
     {
@@ -232,7 +232,7 @@ namespace gpx
     {
       self->makeAttribute(atts[i]);
       
-      self->value(atts[i+1]);
+      self->value(atts[i+1], strlen(atts[i+1]));
       
       self->made();
     }
@@ -249,9 +249,8 @@ namespace gpx
   {
     Parser *self = static_cast<Parser*>(userData);
     
-    string data(s, size_t(len));
-    
-    self->value(data);
+    // No copy: text goes straight to the node value in the arena
+    self->value(s, size_t(len));
   }
 
   void Parser::commentHandler(void *userData, const XML_Char *data)
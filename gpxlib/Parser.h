@@ -113,9 +113,10 @@ namespace gpx
     ///
     /// Set the value
     ///
-    /// @param value   the value of the attribute or element
+    /// @param data    the value of the attribute or element
+    /// @param length  the length of the value
     ///
-    virtual void value(std::string value);
+    virtual void value(const char *data, size_t length);
 
   public:
 
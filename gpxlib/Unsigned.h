@@ -68,7 +68,7 @@ namespace gpx
     virtual bool validate(Report *report = nullptr) const;
     
 	operator unsigned int() const { 
-		return std::stoi(this->getValue());
+		return std::stoi(std::string(this->getValue()));
 	}
     
     private:
@@ -78,11 +78,11 @@ namespace gpx
     }
   }
 
-  std::string Writer::translate(const std::string &value)
+  std::string Writer::translate(std::string_view value)
   {
     string output;
 
-    for (string::const_iterator ch = value.begin(); ch != value.end(); ++ch)
+    for (std::string_view::const_iterator ch = value.begin(); ch != value.end(); ++ch)
     {
       switch(*ch)
       {
@@ -106,7 +106,7 @@ namespace gpx
     stream << '<' << node->getName();
 
     // attributes
-    for (list<Node*>::const_iterator iter = node->getAttributes().begin(); iter != node->getAttributes().end(); ++iter)
+    for (Node::Nodes::const_iterator iter = node->getAttributes().begin(); iter != node->getAttributes().end(); ++iter)
     {
       stream << ' ' << (*iter)->getName() << "=\"" << translate((*iter)->getValue()) << '"';
     }
@@ -122,7 +122,7 @@ namespace gpx
     // child tags
     int next = (level >= 0 ? level+1 : level);
 
-    for (list<Node*>::const_iterator iter = node->getElements().begin(); iter != node->getElements().end(); ++iter)
+    for (Node::Nodes::const_iterator iter = node->getElements().begin(); iter != node->getElements().end(); ++iter)
     {
       doWrite(stream, (*iter), next);
     }
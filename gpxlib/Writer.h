@@ -75,7 +75,7 @@ namespace gpx
     void indent(std::ostream &stream, int level);
 
     static
-    std::string translate(const std::string &value);
+    std::string translate(std::string_view value);
 
     bool doWrite(std::ostream &stream, Node *node, int level);
 
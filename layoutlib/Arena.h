@@ -0,0 +1,143 @@
+#ifndef __LAYOUT__ARENA_H__
+#define __LAYOUT__ARENA_H__
+
+//==============================================================================
+//
+//                   Arena - the node tree allocator
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//==============================================================================
+
+#include <cstddef>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+
+namespace layout
+{
+  ///
+  /// @class Arena
+  ///
+  /// @brief Bump allocator owning a whole node tree.
+  ///
+  /// Nodes, child lists and values are carved out of large blocks and
+  /// are never freed one by one: the blocks are released together with
+  /// the arena. Element and attribute names are interned.
+  ///
+
+  class Arena
+  {
+    public:
+
+    ///
+    /// STL allocator on an arena (deallocate is a no-op)
+    ///
+    template<class T>
+    class Allocator
+    {
+      public:
+
+      typedef T value_type;
+
+      Allocator(Arena *arena) : _arena(arena) { }
+
+      template<class U>
+      Allocator(const Allocator<U> &other) : _arena(other.arena()) { }
+
+      T *allocate(size_t n) { return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T))); }
+
+      void deallocate(T *, size_t) { }
+
+      Arena *arena() const { return _arena; }
+
+      template<class U>
+      bool operator==(const Allocator<U> &other) const { return _arena == other.arena(); }
+
+      template<class U>
+      bool operator!=(const Allocator<U> &other) const { return _arena != other.arena(); }
+
+      private:
+
+      Arena *_arena;
+    };
+
+    ///
+    /// Constructor
+    ///
+    Arena();
+
+    ///
+    /// Deconstructor, releases every block
+    ///
+    ~Arena();
+
+    ///
+    /// Allocate memory in the arena
+    ///
+    /// @param  size   the size in bytes
+    /// @param  align  the alignment
+    ///
+    /// @return the memory (never 0)
+    ///
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+    ///
+    /// Intern a name
+    ///
+    /// @param  name   the name
+    ///
+    /// @return the unique copy of the name in the arena
+    ///
+    const char *intern(const char *name);
+
+    ///
+    /// Append text to a value stored in the arena
+    ///
+    /// @param  value    the current value (empty or returned by a previous call)
+    /// @param  capacity the bytes reserved for the value (0 if not in the arena)
+    /// @param  text     the text to append
+    /// @param  length   the length of the text
+    ///
+    /// @return the new value, nul terminated. It grows in place while it fits
+    ///         its reservation or is the last allocation of the arena, else it
+    ///         moves to a twice larger reservation (as std::string does)
+    ///
+    std::string_view append(std::string_view value, size_t &capacity, const char *text, size_t length);
+
+    ///
+    /// Number of bytes reserved by the arena
+    ///
+    size_t capacity() const { return _capacity; }
+
+    private:
+
+    // Members
+    std::vector<char*>                     _blocks;
+    char                                  *_top;
+    size_t                                 _left;
+    size_t                                 _capacity;
+    std::unordered_set<std::string_view>   _names;
+
+    // Do not implement
+    Arena(const Arena &);
+    Arena& operator=(const Arena &);
+  };
+}
+
+
+#endif
+
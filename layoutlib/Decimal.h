@@ -72,14 +72,14 @@ namespace layout
 		if (this->getValue().empty())
 			return 0;
 
-		return std::stoi(this->getValue());
+		return std::stoi(std::string(this->getValue()));
 	}
     
 	operator double() const { 
 		if (this->getValue().empty())
 			return 0.0;
 
-		return std::stod(this->getValue());
+		return std::stod(std::string(this->getValue()));
 	}
     
   protected:
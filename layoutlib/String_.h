@@ -58,7 +58,7 @@ namespace layout
     virtual ~String();
     
 	operator const char *() const { 
-		return this->getValue().c_str();
+		return this->getValue().data();
 	}
 
     private:
@@ -71,7 +71,7 @@ namespace layout
 		if (this->getValue().empty())
 			return 0;
 
-		return std::stoi(this->getValue());
+		return std::stoi(std::string(this->getValue()));
 	}
     
     private:
@@ -0,0 +1,137 @@
+#include "log.h"
+#include "audiopipeline.h"
+
+
+AudioPipeline::AudioPipeline(Decoder *decoder, const AudioParams &params, const AVRational &time_base)
+	: decoder_(decoder)
+	, params_(params)
+	, time_base_(time_base)
+	, running_(false)
+	, stopping_(false)
+	, limited_(false)
+	, limit_(av_make_q(0, 1)) {
+}
+
+
+AudioPipeline::~AudioPipeline() {
+	stop();
+
+	// Decoded frame never encoded
+	if (pending_ != NULL) {
+		AVFrame *frame = (AVFrame *) pending_->data();
+
+		av_frame_free(&frame);
+
+		pending_->setData(NULL);
+	}
+}
+
+
+AudioPipeline * AudioPipeline::create(Decoder *decoder, const AudioParams &params, const AVRational &time_base) {
+	AudioPipeline *pipeline = new AudioPipeline(decoder, params, time_base);
+
+	return pipeline;
+}
+
+
+void AudioPipeline::append(Encoder *encoder) {
+	encoders_.push_back(encoder);
+}
+
+
+void AudioPipeline::clear(void) {
+	encoders_.clear();
+}
+
+
+bool AudioPipeline::start(void) {
+	log_call();
+
+	if (running_)
+		return true;
+
+	stopping_ = false;
+	running_ = true;
+
+	thread_ = std::thread(&AudioPipeline::loop, this);
+
+	return true;
+}
+
+
+void AudioPipeline::advance(const AVRational &time) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		limited_ = true;
+		limit_ = time;
+	}
+
+	cond_.notify_one();
+}
+
+
+void AudioPipeline::stop(void) {
+	log_call();
+
+	if (!running_)
+		return;
+
+	// Audio is flushed up to the last video time, then thread exits
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		stopping_ = true;
+	}
+
+	cond_.notify_one();
+
+	thread_.join();
+
+	running_ = false;
+}
+
+
+void AudioPipeline::loop(void) {
+	AVRational time;
+
+	for (;;) {
+		// Decode next audio frame (kept if video isn't there yet)
+		if (pending_ == NULL) {
+			pending_ = decoder_->retrieveAudio(params_, av_make_q(0, 1));
+
+			if (pending_ == NULL)
+				break;
+		}
+
+		time = av_mul_q(av_make_q(pending_->timestamp(), 1), time_base_);
+
+		// Wait for video output to reach this frame
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+
+			cond_.wait(lock, [&] {
+				return stopping_ || (limited_ && (av_cmp_q(time, limit_) < 0));
+			});
+
+			if (!limited_ || (av_cmp_q(time, limit_) >= 0))
+				break;
+		}
+
+		// Encoder frees the audio frame, so each output but the last one gets a copy
+		for (Encoder *encoder : encoders_) {
+			FramePtr frame = pending_;
+
+			if (encoder != encoders_.back()) {
+				frame = Frame::create();
+				frame->setTimestamp(pending_->timestamp());
+				frame->setData((uint8_t *) av_frame_clone((AVFrame *) pending_->data()));
+			}
+
+			encoder->writeAudio(frame, time);
+		}
+
+		pending_ = NULL;
+	}
+}
+
@@ -0,0 +1,62 @@
+#ifndef __GPX2VIDEO__AUDIOPIPELINE_H__
+#define __GPX2VIDEO__AUDIOPIPELINE_H__
+
+#include <list>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+extern "C" {
+#include <libavutil/rational.h>
+}
+
+#include "frame.h"
+#include "audioparams.h"
+#include "decoder.h"
+#include "encoder.h"
+
+
+/**
+ * Audio decode, resampling & encode run on their own thread.
+ * Video loop only publishes its output time, audio follows up to it.
+ */
+class AudioPipeline {
+public:
+	virtual ~AudioPipeline();
+
+	static AudioPipeline * create(Decoder *decoder, const AudioParams &params, const AVRational &time_base);
+
+	void append(Encoder *encoder);
+	void clear(void);
+
+	bool start(void);
+	void advance(const AVRational &time);
+	void stop(void);
+
+private:
+	AudioPipeline(Decoder *decoder, const AudioParams &params, const AVRational &time_base);
+
+	void loop(void);
+
+	Decoder *decoder_;
+	AudioParams params_;
+	AVRational time_base_;
+
+	std::list<Encoder *> encoders_;
+
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable cond_;
+
+	bool running_;
+	bool stopping_;
+
+	// Video output time reached
+	bool limited_;
+	AVRational limit_;
+
+	// Decoded frame waiting for video
+	FramePtr pending_;
+};
+
+#endif
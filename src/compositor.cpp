@@ -0,0 +1,118 @@
+#include <algorithm>
+
+#include <OpenImageIO/parallel.h>
+
+#include "log.h"
+#include "macros.h"
+#include "compositor.h"
+
+
+Compositor::Compositor(const OIIO::ImageSpec &spec)
+	: spec_(spec)
+	, band_height_(0) {
+}
+
+
+Compositor::~Compositor() {
+	for (Layer &layer : layers_) {
+		if (layer.owned())
+			delete layer.buffer();
+	}
+
+	layers_.clear();
+}
+
+
+Compositor * Compositor::create(const OIIO::ImageSpec &spec) {
+	Compositor *compositor = new Compositor(spec);
+
+	compositor->init();
+
+	return compositor;
+}
+
+
+void Compositor::init(void) {
+	size_t linesize;
+
+	log_call();
+
+	// Rows per band
+	linesize = MAX((size_t) 1, spec_.scanline_bytes());
+
+	band_height_ = COMPOSITOR_BAND_SIZE / linesize;
+	band_height_ = MAX(8, band_height_);
+}
+
+
+OIIO::ImageBuf * Compositor::append(int z, OIIO::ROI rect, Compositor::Blend blend, OIIO::ImageBuf *buf) {
+	bool owned = false;
+
+	log_call();
+
+	// Clip to frame
+	rect = OIIO::roi_intersection(rect, OIIO::ROI(0, spec_.width, 0, spec_.height));
+
+	if (!rect.defined() || (rect.width() <= 0) || (rect.height() <= 0))
+		return NULL;
+
+	// Layer buffer covers only its rect
+	if (buf == NULL) {
+		OIIO::ImageSpec spec(rect.width(), rect.height(), spec_.nchannels, spec_.format);
+
+		spec.x = rect.xbegin;
+		spec.y = rect.ybegin;
+
+		buf = new OIIO::ImageBuf(spec);
+		owned = true;
+	}
+
+	layers_.push_back(Layer(z, rect, blend, buf, owned));
+
+	return buf;
+}
+
+
+void Compositor::compile(void) {
+	log_call();
+
+	// Draw list is z-ordered (append order is kept for a same z)
+	std::stable_sort(layers_.begin(), layers_.end(), [](const Layer &a, const Layer &b) {
+		return a.z() < b.z();
+	});
+
+	log_info("Compositor %d layers, band of %d rows", (int) layers_.size(), band_height_);
+}
+
+
+void Compositor::compose(OIIO::ImageBuf &frame) {
+	int64_t nbr_bands;
+
+	OIIO::ROI roi = frame.roi();
+
+	if (layers_.empty())
+		return;
+
+	nbr_bands = (roi.height() + band_height_ - 1) / band_height_;
+
+	// Each band is walked once, all layers are blended while band is in cache
+	OIIO::parallel_for(int64_t(0), nbr_bands, [&](int64_t i) {
+		int y = roi.ybegin + i * band_height_;
+
+		OIIO::ROI band(roi.xbegin, roi.xend, y, MIN(y + band_height_, roi.yend));
+
+		for (const Layer &layer : layers_) {
+			OIIO::ROI rect = OIIO::roi_intersection(band, layer.rect());
+
+			if (!rect.defined() || (rect.width() <= 0) || (rect.height() <= 0))
+				continue;
+
+			switch (layer.blend()) {
+			case BlendOver:
+			default:
+				OIIO::ImageBufAlgo::over(frame, *layer.buffer(), frame, rect, 1);
+				break;
+			}
+		}
+	});
+}
@@ -0,0 +1,82 @@
+#ifndef __GPX2VIDEO__COMPOSITOR_H__
+#define __GPX2VIDEO__COMPOSITOR_H__
+
+#include <string>
+#include <vector>
+
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+
+
+// Band size target (in bytes), a band has to stay in cache
+#define COMPOSITOR_BAND_SIZE (256 * 1024)
+
+
+class Compositor {
+public:
+	enum Blend {
+		BlendOver,
+
+		BlendCount
+	};
+
+	class Layer {
+	public:
+		Layer(int z, OIIO::ROI rect, Compositor::Blend blend, OIIO::ImageBuf *buf, bool owned)
+			: z_(z)
+			, rect_(rect)
+			, blend_(blend)
+			, buf_(buf)
+			, owned_(owned) {
+		}
+
+		const int& z(void) const {
+			return z_;
+		}
+
+		const OIIO::ROI& rect(void) const {
+			return rect_;
+		}
+
+		const Compositor::Blend& blend(void) const {
+			return blend_;
+		}
+
+		OIIO::ImageBuf * buffer(void) const {
+			return buf_;
+		}
+
+		const bool& owned(void) const {
+			return owned_;
+		}
+
+	private:
+		int z_;
+		OIIO::ROI rect_;
+		Compositor::Blend blend_;
+		OIIO::ImageBuf *buf_;
+		bool owned_;
+	};
+
+	virtual ~Compositor();
+
+	static Compositor * create(const OIIO::ImageSpec &spec);
+
+	OIIO::ImageBuf * append(int z, OIIO::ROI rect, Blend blend=BlendOver, OIIO::ImageBuf *buf=NULL);
+
+	void compile(void);
+	void compose(OIIO::ImageBuf &frame);
+
+private:
+	Compositor(const OIIO::ImageSpec &spec);
+
+	void init(void);
+
+	OIIO::ImageSpec spec_;
+
+	int band_height_;
+
+	std::vector<Layer> layers_;
+};
+
+#endif
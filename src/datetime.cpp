@@ -0,0 +1,103 @@
+#include <string.h>
+
+#include "datetime.h"
+
+
+// Length of "YYYY-MM-DDTHH:MM:SS"
+#define DATETIME_LENGTH 19
+
+
+int64_t days_from_civil(int y, unsigned m, unsigned d) {
+	y -= (m <= 2);
+
+	const int era = (y >= 0 ? y : y - 399) / 400;
+	const unsigned yoe = (unsigned) (y - era * 400);
+	const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return (int64_t) era * 146097 + (int64_t) doe - 719468;
+}
+
+
+bool parse_datetime_ms(const char *s, int64_t *time_ms) {
+	unsigned bad = 0;
+
+	int64_t days;
+	int64_t zone = 0;
+
+	const unsigned char *p = (const unsigned char *) s;
+
+	// Each field is at a fixed position: no branch per digit, errors are or-ed
+	auto digit = [&](int i) -> unsigned {
+		unsigned d = p[i] - '0';
+
+		bad |= (d > 9);
+
+		return d;
+	};
+
+	if ((s == NULL) || (memchr(s, '\0', DATETIME_LENGTH) != NULL))
+		return false;
+
+	const unsigned year = digit(0) * 1000 + digit(1) * 100 + digit(2) * 10 + digit(3);
+	const unsigned month = digit(5) * 10 + digit(6);
+	const unsigned day = digit(8) * 10 + digit(9);
+	const unsigned hour = digit(11) * 10 + digit(12);
+	const unsigned minute = digit(14) * 10 + digit(15);
+	const unsigned second = digit(17) * 10 + digit(18);
+
+	// Date separators: '-' (ISO-8601) or ':' (GoPro / exiftool)
+	bad |= (p[4] != p[7]) | ((p[4] != '-') & (p[4] != ':'));
+	bad |= (p[10] != 'T') & (p[10] != ' ');
+	bad |= (p[13] != ':') | (p[16] != ':');
+
+	bad |= (month - 1 > 11) | (day - 1 > 30) | (hour > 23) | (minute > 59) | (second > 60);
+
+	if (bad)
+		return false;
+
+	p += DATETIME_LENGTH;
+
+	// Fraction, only ms are kept
+	unsigned ms = 0;
+
+	if ((*p == '.') || (*p == ',')) {
+		unsigned scale = 100;
+
+		for (p++; (unsigned) (*p - '0') <= 9; p++) {
+			ms += (*p - '0') * scale;
+			scale /= 10;
+		}
+	}
+
+	// Time zone, none means UTC
+	if ((*p == '+') || (*p == '-')) {
+		const unsigned char *z = p + 1;
+
+		unsigned zh, zm = 0;
+
+		if (((unsigned) (z[0] - '0') > 9) || ((unsigned) (z[1] - '0') > 9))
+			return false;
+
+		zh = (z[0] - '0') * 10 + (z[1] - '0');
+		z += 2;
+
+		if (*z == ':')
+			z++;
+
+		if (((unsigned) (z[0] - '0') <= 9) && ((unsigned) (z[1] - '0') <= 9))
+			zm = (z[0] - '0') * 10 + (z[1] - '0');
+
+		zone = (int64_t) (zh * 60 + zm) * 60 * 1000;
+
+		if (*p == '+')
+			zone = -zone;
+	}
+
+	days = days_from_civil(year, month, day);
+
+	*time_ms = ((days * 24 + hour) * 60 + minute) * 60 * 1000 + (int64_t) second * 1000 + ms + zone;
+
+	return true;
+}
+
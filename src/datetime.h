@@ -0,0 +1,20 @@
+#ifndef __GPX2VIDEO__DATETIME_H__
+#define __GPX2VIDEO__DATETIME_H__
+
+#include <stdint.h>
+
+
+/**
+ * Locale free UTC date parser, result in epoch milliseconds.
+ * Accepted formats:
+ *   ISO-8601   "2020-07-28T07:04:43.000Z", "2020-07-28T09:04:43+02:00"
+ *   GoPro      "2020:12:13 08:55:48.215"
+ *   GPMF       "2021-12-08 08:55:46.039"
+ * Fraction and time zone are optional, fraction is truncated to the ms.
+ */
+bool parse_datetime_ms(const char *s, int64_t *time_ms);
+
+// Days since 1970-01-01 (proleptic Gregorian calendar)
+int64_t days_from_civil(int y, unsigned m, unsigned d);
+
+#endif
@@ -11,7 +11,11 @@
 Decoder::Decoder()
 	: fmt_ctx_(NULL)
 	, codec_ctx_(NULL)
-	, sws_ctx_(NULL) {
+	, sws_ctx_(NULL)
+	, frame_drop_(false)
+	, low_delay_(false)
+	, start_pts_(AV_NOPTS_VALUE)
+	, seek_pts_(AV_NOPTS_VALUE) {
 }
 
 
@@ -224,7 +228,17 @@ bool Decoder::open(StreamPtr stream) {
 bool Decoder::open(const std::string &filename, const int &index) {
 	int result;
 
-	if ((result = avformat_open_input(&fmt_ctx_, filename.c_str(), NULL, NULL)) < 0) {
+	AVDictionary *options = NULL;
+
+	// Live input, don't buffer packets in demuxer
+	if (low_delay_)
+		av_dict_set(&options, "fflags", "nobuffer", 0);
+
+	result = avformat_open_input(&fmt_ctx_, filename.c_str(), NULL, &options);
+
+	av_dict_free(&options);
+
+	if (result < 0) {
 		av_log(NULL, AV_LOG_ERROR, "Cannot open input file '%s'", filename.c_str());
 		return false;
 	}
@@ -238,6 +252,9 @@ bool Decoder::open(const std::string &filename, const int &index) {
 	// Get reference to correct AVStream
 	avstream_ = fmt_ctx_->streams[index];
 
+	// Stream first timestamp
+	start_pts_ = avstream_->start_time;
+
 	// Find decoder
 	const AVCodec *decoder = avcodec_find_decoder(avstream_->codecpar->codec_id);
 
@@ -262,6 +279,10 @@ bool Decoder::open(const std::string &filename, const int &index) {
 		return false;
 	}
 
+	// Live input, output frames as soon as possible
+	if (low_delay_)
+		codec_ctx_->flags |= AV_CODEC_FLAG_LOW_DELAY;
+
 	// Open decoder
 	result = avcodec_open2(codec_ctx_, decoder, NULL);
 
@@ -321,6 +342,84 @@ int Decoder::getFrame(AVPacket *packet, AVFrame *frame) {
 }
 
 
+bool Decoder::seek(const int64_t &target_ts) {
+	int result;
+
+	log_call();
+
+	// Seek to the nearest preceding keyframe
+	result = av_seek_frame(fmt_ctx_, avstream_->index, target_ts, AVSEEK_FLAG_BACKWARD);
+
+	if (result < 0) {
+		log_error("Decoder fails to seek to %ld", target_ts);
+		return false;
+	}
+
+	avcodec_flush_buffers(codec_ctx_);
+
+	// Then frames up to target are decoded & dropped
+	seek_pts_ = target_ts;
+
+	return true;
+}
+
+
+/**
+ * Longest interval between two keyframes (in stream time base), from the
+ * demuxer index (MP4/MOV sync samples). 0 if unknown (no index, as in TS).
+ */
+int64_t Decoder::keyFrameInterval(void) {
+	int i, n;
+
+	int64_t interval = 0;
+	int64_t last = AV_NOPTS_VALUE;
+
+	log_call();
+
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(58, 78, 100)
+	n = avformat_index_get_entries_count(avstream_);
+#else
+	n = avstream_->nb_index_entries;
+#endif
+
+	for (i=0; i<n; i++) {
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(58, 78, 100)
+		const AVIndexEntry *entry = avformat_index_get_entry(avstream_, i);
+#else
+		const AVIndexEntry *entry = &avstream_->index_entries[i];
+#endif
+
+		if (!(entry->flags & AVINDEX_KEYFRAME))
+			continue;
+
+		if (last != AV_NOPTS_VALUE)
+			interval = std::max(interval, entry->timestamp - last);
+
+		last = entry->timestamp;
+	}
+
+	return interval;
+}
+
+
+void Decoder::setKeyFrameOnly(bool enable) {
+	// Decoder discards non-keyframes, so they are never decoded
+	if (codec_ctx_)
+		codec_ctx_->skip_frame = enable ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+}
+
+
+void Decoder::setFrameDrop(bool enable) {
+	frame_drop_ = enable;
+}
+
+
+void Decoder::setLowDelay(bool enable) {
+	// Has to be set before open
+	low_delay_ = enable;
+}
+
+
 void Decoder::close(void) {
 	if (sws_ctx_) {
 		sws_freeContext(sws_ctx_);
@@ -375,25 +474,7 @@ uint8_t * Decoder::retrieveAudioFrameData(const AudioParams &params, const int64
 
 //	printf("RETRIEVE: %ld\n", target_ts);
 
-	// Handle NULL channel layout
-	uint64_t channel_layout = validateChannelLayout(avstream_);
-	if (!channel_layout) {                     
-		fprintf(stderr, "Failed to determine channel layout of audio file, could not conform\n");
-//		return NULL;
-	}                                          
-
-//	// Create resampling context
-//	SwrContext* resampler = swr_alloc_set_opts(NULL,
-//			params.channelLayout(),                        
-//			FFmpegUtils::getFFmpegSampleFormat(params.format()),
-//			params.sampleRate(),                           
-//			channel_layout,                                 
-//			static_cast<AVSampleFormat>(avstream_->codecpar->format),
-//			avstream_->codecpar->sample_rate,    
-//			0,
-//			NULL);                                       
-//  
-//	swr_init(resampler);   
+	// Decoded frame is returned as is, it's resampled on encoder input (see Encoder::writeAudio)
 
 	while (true) {
 		// Pull from decoder
@@ -408,12 +489,13 @@ uint8_t * Decoder::retrieveAudioFrameData(const AudioParams &params, const int64
 			break;
 		}
 
-//		// Allocate buffers
-//		int nb_samples = swr_get_out_samples(resampler, frame->nb_samples);
-//		size_t size = params.samplesToBytes(nb_samples);
-//		data = (uint8_t *) malloc(size * sizeof(uint8_t));
+		// Drop frames before seek target
+		if ((seek_pts_ != AV_NOPTS_VALUE) && (frame->pts < seek_pts_))
+			continue;
 
-		// Store data (TOOD...)
+		seek_pts_ = AV_NOPTS_VALUE;
+
+		// Store data
 		data = (uint8_t *) frame;
 
 		pts_ = frame->pts;
@@ -421,11 +503,12 @@ uint8_t * Decoder::retrieveAudioFrameData(const AudioParams &params, const int64
 		break;
 	}
 
-//	swr_free(&resampler);
-
 //	printf("  PTS: %ld\n", pts_);
 
-//	av_frame_free(&frame);
+	// End of stream
+	if (data == NULL)
+		av_frame_free(&frame);
+
 	av_packet_free(&packet);
 
 	return data;
@@ -466,8 +549,6 @@ uint8_t * Decoder::retrieveVideoFrameData(const int64_t& target_ts) {
 	AVPacket *packet = av_packet_alloc();
 	AVFrame *frame = av_frame_alloc();
 
-	(void) target_ts;
-
 //	printf("RETRIEVE: %ld\n", target_ts);
 
 	while (true) {
@@ -483,6 +564,21 @@ uint8_t * Decoder::retrieveVideoFrameData(const int64_t& target_ts) {
 			break;
 		}
 
+		// Drop frames before seek target
+		if ((seek_pts_ != AV_NOPTS_VALUE) && (frame->pts < seek_pts_))
+			continue;
+
+		seek_pts_ = AV_NOPTS_VALUE;
+
+		// Drop frames before target (target is relative to the first frame)
+		if (frame_drop_) {
+			if (start_pts_ == AV_NOPTS_VALUE)
+				start_pts_ = frame->pts;
+
+			if ((frame->pts - start_pts_) < target_ts)
+				continue;
+		}
+
 		// Store data
 		int linesize = Frame::generateLinesizeBytes(frame->width, native_pix_fmt_, native_nb_channels_);
 		size_t size = VideoParams::getBufferSize(linesize, frame->height, native_pix_fmt_, native_nb_channels_);
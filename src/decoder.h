@@ -25,6 +25,8 @@ public:
 	static Decoder * create(void);
 
 	bool open(StreamPtr stream);
+	bool seek(const int64_t &target_ts);
+	int64_t keyFrameInterval(void);
 	int getFrame(AVPacket *packet, AVFrame *frame);
 	void close(void);
 
@@ -34,6 +36,10 @@ public:
 	FramePtr retrieveVideo(AVRational timecode);
 	uint8_t * retrieveVideoFrameData(const int64_t& target_ts);
 
+	void setKeyFrameOnly(bool enable);
+	void setFrameDrop(bool enable);
+	void setLowDelay(bool enable);
+
 protected:
 	StreamPtr stream(void) const {
 		return stream_;
@@ -61,6 +67,11 @@ private:
 
 	SwsContext *sws_ctx_;
 
+	bool frame_drop_;
+	bool low_delay_;
+	int64_t start_pts_;
+	int64_t seek_pts_;
+
 	int64_t pts_;
 };
 
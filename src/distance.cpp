@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <vector>
+
+#include <math.h>
+#include <string.h>
+
+#include "distance.h"
+
+
+// Vector of DISTANCE_SIMD_WIDTH doubles (GCC vector extension)
+typedef double vdouble __attribute__((vector_size(DISTANCE_SIMD_WIDTH * sizeof(double))));
+
+
+Distance::Accuracy Distance::accuracy_ = Distance::AccuracyGeodesic;
+
+
+const Distance::Accuracy& Distance::accuracy(void) {
+	return accuracy_;
+}
+
+
+void Distance::setAccuracy(const Distance::Accuracy &accuracy) {
+	accuracy_ = accuracy;
+}
+
+
+const std::string Distance::getFriendlyName(const Distance::Accuracy &accuracy) {
+	switch (accuracy) {
+	case AccuracyGeodesic:
+		return "Geodesic distance on the ellipsoid (exact)";
+	case AccuracyHaversine:
+		return "Haversine distance on a sphere (fast, < 0.5% error)";
+	case AccuracyCount:
+	default:
+		return "";
+	}
+
+	return "";
+}
+
+
+const GeographicLib::Geodesic& Distance::solver(void) {
+	static const GeographicLib::Geodesic gsic(DISTANCE_ELLIPSOID_A, DISTANCE_ELLIPSOID_F);
+
+	return gsic;
+}
+
+
+void Distance::segments(const double *lat, const double *lon, size_t n, double *out, Distance::Accuracy accuracy) {
+	size_t i;
+
+	if (n == 0)
+		return;
+
+	if (accuracy == AccuracyHaversine) {
+		haversine(lat, lon, n, out);
+		return;
+	}
+
+	const GeographicLib::Geodesic &gsic = solver();
+
+	out[0] = 0.0;
+
+	for (i=1; i<n; i++)
+		gsic.Inverse(lat[i-1], lon[i-1], lat[i], lon[i], out[i]);
+}
+
+
+// sin(x) for |x| <= DISTANCE_SMALL_ANGLE (Taylor series up to x^7)
+static inline vdouble sin_small(vdouble x) {
+	vdouble x2 = x * x;
+
+	return x * (1.0 - x2 / 6.0 * (1.0 - x2 / 20.0 * (1.0 - x2 / 42.0)));
+}
+
+
+// asin(s) for small s (series up to s^7)
+static inline vdouble asin_small(vdouble s) {
+	vdouble s2 = s * s;
+
+	return s * (1.0 + s2 * (1.0 / 6.0 + s2 * (3.0 / 40.0 + s2 * (5.0 / 112.0))));
+}
+
+
+static inline double haversine_scalar(double lat1, double lon1, double coslat1,
+	double lat2, double lon2, double coslat2) {
+	double dlat = sin((lat2 - lat1) * M_PI / 360.0);
+	double dlon = sin((lon2 - lon1) * M_PI / 360.0);
+
+	double h = dlat * dlat + coslat1 * coslat2 * dlon * dlon;
+
+	return 2.0 * DISTANCE_SPHERE_RADIUS * asin(sqrt(std::min(h, 1.0)));
+}
+
+
+double Distance::compute(double lat1, double lon1, double lat2, double lon2, Distance::Accuracy accuracy) {
+	double d;
+
+	// Single segment, no batch (haversine() allocates its cos column)
+	if (accuracy == AccuracyHaversine)
+		return haversine_scalar(lat1, lon1, cos(lat1 * M_PI / 180.0), lat2, lon2, cos(lat2 * M_PI / 180.0));
+
+	solver().Inverse(lat1, lon1, lat2, lon2, d);
+
+	return d;
+}
+
+
+void Distance::haversine(const double *lat, const double *lon, size_t n, double *out) {
+	size_t i, j;
+
+	std::vector<double> coslat(n);
+
+	// One cos per point, shared by both segments using it
+	for (i=0; i<n; i++)
+		coslat[i] = cos(lat[i] * M_PI / 180.0);
+
+	out[0] = 0.0;
+
+	// Segments i-1 -> i, DISTANCE_SIMD_WIDTH at once
+	for (i=1; i+DISTANCE_SIMD_WIDTH<=n; i+=DISTANCE_SIMD_WIDTH) {
+		vdouble lat1, lat2, lon1, lon2, c1, c2;
+
+		memcpy(&lat1, lat + i - 1, sizeof(lat1));
+		memcpy(&lat2, lat + i, sizeof(lat2));
+		memcpy(&lon1, lon + i - 1, sizeof(lon1));
+		memcpy(&lon2, lon + i, sizeof(lon2));
+		memcpy(&c1, &coslat[i - 1], sizeof(c1));
+		memcpy(&c2, &coslat[i], sizeof(c2));
+
+		vdouble dlat = (lat2 - lat1) * (M_PI / 360.0);
+		vdouble dlon = (lon2 - lon1) * (M_PI / 360.0);
+
+		// Long segments (or 180th meridian crossing) go through libm
+		bool small = true;
+
+		for (j=0; j<DISTANCE_SIMD_WIDTH; j++)
+			small &= (fabs(dlat[j]) <= DISTANCE_SMALL_ANGLE) & (fabs(dlon[j]) <= DISTANCE_SMALL_ANGLE);
+
+		if (!small) {
+			for (j=0; j<DISTANCE_SIMD_WIDTH; j++)
+				out[i + j] = haversine_scalar(lat[i + j - 1], lon[i + j - 1], coslat[i + j - 1],
+					lat[i + j], lon[i + j], coslat[i + j]);
+			continue;
+		}
+
+		vdouble slat = sin_small(dlat);
+		vdouble slon = sin_small(dlon);
+
+		vdouble h = slat * slat + c1 * c2 * slon * slon;
+		vdouble s;
+
+		for (j=0; j<DISTANCE_SIMD_WIDTH; j++)
+			s[j] = sqrt(h[j]);
+
+		vdouble d = (2.0 * DISTANCE_SPHERE_RADIUS) * asin_small(s);
+
+		memcpy(out + i, &d, sizeof(d));
+	}
+
+	// Remaining segments
+	for (; i<n; i++)
+		out[i] = haversine_scalar(lat[i-1], lon[i-1], coslat[i-1], lat[i], lon[i], coslat[i]);
+}
+
@@ -0,0 +1,59 @@
+#ifndef __GPX2VIDEO__DISTANCE_H__
+#define __GPX2VIDEO__DISTANCE_H__
+
+#include <string>
+
+#include <stddef.h>
+
+#include <GeographicLib/Geodesic.hpp>
+
+
+// International 1924 ellipsoid (as used since the first GPX reader)
+#define DISTANCE_ELLIPSOID_A 6378388.0
+#define DISTANCE_ELLIPSOID_F (1/297.0)
+
+// Mean radius of this ellipsoid, for spherical distances
+#define DISTANCE_SPHERE_RADIUS 6371229.3
+
+// Lanes of the batch kernel (one SSE2 / NEON register)
+#define DISTANCE_SIMD_WIDTH 2
+
+// Half angle (rad) up to which the kernel series are exact to double precision
+#define DISTANCE_SMALL_ANGLE 0.05
+
+
+/**
+ * Distance between GPS points, in meters.
+ * Geodesic is exact on the ellipsoid, haversine is a spherical approximation
+ * (< 0.5% error) computed in batch by SIMD lanes.
+ */
+class Distance {
+public:
+	enum Accuracy {
+		AccuracyGeodesic = 0,
+		AccuracyHaversine,
+
+		AccuracyCount
+	};
+
+	// Default mode for the whole process
+	static const Accuracy& accuracy(void);
+	static void setAccuracy(const Accuracy &accuracy);
+
+	static const std::string getFriendlyName(const Accuracy &accuracy);
+
+	// Shared solver, built once
+	static const GeographicLib::Geodesic& solver(void);
+
+	static double compute(double lat1, double lon1, double lat2, double lon2, Accuracy accuracy=Distance::accuracy());
+
+	// out[i] is the distance from point i-1 to point i (out[0] = 0)
+	static void segments(const double *lat, const double *lon, size_t n, double *out, Accuracy accuracy=Distance::accuracy());
+
+private:
+	static void haversine(const double *lat, const double *lon, size_t n, double *out);
+
+	static Accuracy accuracy_;
+};
+
+#endif
@@ -1,4 +1,11 @@
+#include <vector>
+
+extern "C" {
+#include <libavutil/opt.h>
+}
+
 #include "log.h"
+#include "macros.h"
 #include "ffmpegutils.h"
 #include "encoder.h"
 
@@ -8,6 +15,7 @@ EncoderSettings::EncoderSettings() :
 	video_bit_rate_(0),
 	video_max_bit_rate_(0),
 	video_buffer_size_(0),
+	low_delay_(false),
 	audio_enabled_(false) {
 }
 
@@ -55,21 +63,56 @@ bool EncoderSettings::isVideoEnabled(void) const {
 }
 
 
+const int64_t& EncoderSettings::videoBitrate(void) const {
+	return video_bit_rate_;
+}
+
+
 void EncoderSettings::setVideoBitrate(const int64_t rate) {
 	video_bit_rate_ = rate;
 }
 
 
+const int64_t& EncoderSettings::videoMaxBitrate(void) const {
+	return video_max_bit_rate_;
+}
+
+
 void EncoderSettings::setVideoMaxBitrate(const int64_t rate) {
 	video_max_bit_rate_ = rate;
 }
 
 
+const int64_t& EncoderSettings::videoBufferSize(void) const {
+	return video_buffer_size_;
+}
+
+
 void EncoderSettings::setVideoBufferSize(const int64_t size) {
 	video_buffer_size_ = size;
 }
 
 
+const std::string& EncoderSettings::videoPreset(void) const {
+	return video_preset_;
+}
+
+
+void EncoderSettings::setVideoPreset(const std::string &preset) {
+	video_preset_ = preset;
+}
+
+
+bool EncoderSettings::isLowDelay(void) const {
+	return low_delay_;
+}
+
+
+void EncoderSettings::setLowDelay(bool enable) {
+	low_delay_ = enable;
+}
+
+
 bool EncoderSettings::isAudioEnabled(void) const {
 	return audio_enabled_;
 }
@@ -83,11 +126,16 @@ void EncoderSettings::setAudioBitrate(const int64_t rate) {
 Encoder::Encoder(const EncoderSettings &settings) : 
 	settings_(settings),
 	open_(false),
+	started_(false),
+	start_time_(av_make_q(0, 1)),
 	fmt_ctx_(NULL),
 	video_stream_(NULL),
 	video_codec_(NULL),
 	audio_stream_(NULL),
-	audio_codec_(NULL) {
+	audio_codec_(NULL),
+	swr_ctx_(NULL),
+	audio_fifo_(NULL),
+	audio_next_pts_(AV_NOPTS_VALUE) {
 	log_call();
 }
 
@@ -109,12 +157,186 @@ Encoder * Encoder::create(const EncoderSettings &settings) {
 }
 
 
+bool Encoder::concat(const std::list<std::string> &filenames, const std::string &filename) {
+	int result;
+
+	unsigned int i;
+
+	bool success = false;
+
+	double offset = 0.0;
+	double duration = 0.0;
+
+	AVFormatContext *ifmt_ctx = NULL;
+	AVFormatContext *ofmt_ctx = NULL;
+
+	AVPacket *packet = NULL;
+
+	std::vector<int64_t> last_dts;
+
+	log_call();
+
+	// Create output context
+	result = avformat_alloc_output_context2(&ofmt_ctx, NULL, NULL, filename.c_str());
+
+	if (result < 0) {
+		av_log(NULL, AV_LOG_ERROR, "Failed to allocate output context\n");
+		goto done;
+	}
+
+	packet = av_packet_alloc();
+
+	for (const std::string &name : filenames) {
+		int vindex = -1;
+
+		if ((result = avformat_open_input(&ifmt_ctx, name.c_str(), NULL, NULL)) < 0) {
+			av_log(NULL, AV_LOG_ERROR, "Cannot open input file '%s'\n", name.c_str());
+			goto done;
+		}
+
+		if ((result = avformat_find_stream_info(ifmt_ctx, NULL)) < 0) {
+			av_log(NULL, AV_LOG_ERROR, "Cannot find stream information\n");
+			goto done;
+		}
+
+		// First segment, create output streams & write header
+		if (ofmt_ctx->nb_streams == 0) {
+			for (i=0; i<ifmt_ctx->nb_streams; i++) {
+				AVStream *stream = avformat_new_stream(ofmt_ctx, NULL);
+
+				if (!stream) {
+					av_log(NULL, AV_LOG_ERROR, "Failed allocating output stream\n");
+					goto done;
+				}
+
+				avcodec_parameters_copy(stream->codecpar, ifmt_ctx->streams[i]->codecpar);
+				stream->codecpar->codec_tag = 0;
+				stream->time_base = ifmt_ctx->streams[i]->time_base;
+
+				last_dts.push_back(AV_NOPTS_VALUE);
+			}
+
+			if (!(ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
+				if ((result = avio_open(&ofmt_ctx->pb, filename.c_str(), AVIO_FLAG_WRITE)) < 0) {
+					av_log(NULL, AV_LOG_ERROR, "Could not open output file '%s'\n", filename.c_str());
+					goto done;
+				}
+			}
+
+			if ((result = avformat_write_header(ofmt_ctx, NULL)) < 0) {
+				av_log(NULL, AV_LOG_ERROR, "Error occurred when opening output file\n");
+				goto done;
+			}
+		}
+
+		if (ifmt_ctx->nb_streams != ofmt_ctx->nb_streams) {
+			av_log(NULL, AV_LOG_ERROR, "Segment '%s' streams mismatch\n", name.c_str());
+			goto done;
+		}
+
+		vindex = av_find_best_stream(ifmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+
+		// Each segment starts at 0, shift it after the previous one
+		offset += duration;
+		duration = 0.0;
+
+		while ((result = av_read_frame(ifmt_ctx, packet)) >= 0) {
+			AVStream *in = ifmt_ctx->streams[packet->stream_index];
+			AVStream *out = ofmt_ctx->streams[packet->stream_index];
+
+			int64_t shift = (int64_t) round(offset / av_q2d(in->time_base));
+
+			// Segment duration from video stream
+			if ((packet->stream_index == vindex) && (packet->pts != AV_NOPTS_VALUE))
+				duration = MAX(duration, (packet->pts + packet->duration) * av_q2d(in->time_base));
+
+			if (packet->pts != AV_NOPTS_VALUE)
+				packet->pts += shift;
+			if (packet->dts != AV_NOPTS_VALUE)
+				packet->dts += shift;
+
+			av_packet_rescale_ts(packet, in->time_base, out->time_base);
+
+			// Skip overlapping packets (audio encoder delay at segment boundaries)
+			if ((packet->dts != AV_NOPTS_VALUE) && (last_dts[packet->stream_index] != AV_NOPTS_VALUE)
+				&& (packet->dts <= last_dts[packet->stream_index])) {
+				av_packet_unref(packet);
+				continue;
+			}
+
+			last_dts[packet->stream_index] = packet->dts;
+
+			packet->pos = -1;
+
+			// Write error (disk full...), the merge fails & the segments are kept
+			if ((result = av_interleaved_write_frame(ofmt_ctx, packet)) < 0) {
+				av_log(NULL, AV_LOG_ERROR, "Error muxing packet to '%s'\n", filename.c_str());
+				goto done;
+			}
+
+			av_packet_unref(packet);
+		}
+
+		if (result != AVERROR_EOF) {
+			av_log(NULL, AV_LOG_ERROR, "Error reading segment '%s'\n", name.c_str());
+			goto done;
+		}
+
+		avformat_close_input(&ifmt_ctx);
+		ifmt_ctx = NULL;
+	}
+
+	// Write trailer
+	if (ofmt_ctx->nb_streams > 0) {
+		if ((result = av_write_trailer(ofmt_ctx)) < 0) {
+			av_log(NULL, AV_LOG_ERROR, "Error writing trailer to '%s'\n", filename.c_str());
+			goto done;
+		}
+	}
+
+	// Merged file is complete only once flushed & closed
+	if (ofmt_ctx->pb && !(ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
+		if (ofmt_ctx->pb->error < 0) {
+			av_log(NULL, AV_LOG_ERROR, "Error writing '%s'\n", filename.c_str());
+			goto done;
+		}
+
+		if ((result = avio_closep(&ofmt_ctx->pb)) < 0) {
+			av_log(NULL, AV_LOG_ERROR, "Error closing '%s'\n", filename.c_str());
+			goto done;
+		}
+	}
+
+	success = true;
+
+done:
+	if (packet)
+		av_packet_free(&packet);
+
+	if (ifmt_ctx)
+		avformat_close_input(&ifmt_ctx);
+
+	if (ofmt_ctx) {
+		if (ofmt_ctx->pb && !(ofmt_ctx->oformat->flags & AVFMT_NOFILE))
+			avio_closep(&ofmt_ctx->pb);
+
+		avformat_free_context(ofmt_ctx);
+	}
+
+	return success;
+}
+
+
 bool Encoder::open(void) {
 	int result;
 
 	// Create output context
     result = avformat_alloc_output_context2(&fmt_ctx_, NULL, NULL, settings_.filename().c_str());
 
+	// Streaming output (udp://, pipe:...), format can't be guessed from name
+	if (result < 0)
+		result = avformat_alloc_output_context2(&fmt_ctx_, NULL, "mpegts", settings_.filename().c_str());
+
 	if (result < 0) {
 		av_log(NULL, AV_LOG_ERROR, "Failed to allocate output context\n");
 		return false;
@@ -169,6 +391,10 @@ bool Encoder::open(void) {
 	// Dump info
     av_dump_format(fmt_ctx_, 0, settings_.filename().c_str(), 1);
 
+	// Live output, packets are sent as soon as they are muxed
+	if (settings().isLowDelay())
+		fmt_ctx_->flush_packets = 1;
+
 	// Open output file for writing
 	if (!(fmt_ctx_->oformat->flags & AVFMT_NOFILE)) {
 		result = avio_open(&fmt_ctx_->pb, settings_.filename().c_str(), AVIO_FLAG_WRITE);
@@ -218,6 +444,16 @@ void Encoder::close(void) {
 		video_codec_ = NULL;
 	}
 
+	if (swr_ctx_) {
+		swr_free(&swr_ctx_);
+		swr_ctx_ = NULL;
+	}
+
+	if (audio_fifo_) {
+		av_audio_fifo_free(audio_fifo_);
+		audio_fifo_ = NULL;
+	}
+
 	if (audio_codec_) {
 		avcodec_free_context(&audio_codec_);
 		audio_codec_ = NULL;
@@ -233,6 +469,14 @@ void Encoder::close(void) {
 void Encoder::flush(void) {
 	if (video_codec_)
 		flush(video_codec_, video_stream_);
+
+	// Samples left in resampler & FIFO (last frame can be shorter)
+	if (swr_ctx_) {
+		resample(NULL);
+
+		while (av_audio_fifo_size(audio_fifo_) > 0)
+			writeAudioSamples(MIN(av_audio_fifo_size(audio_fifo_), (audio_codec_->frame_size > 0) ? audio_codec_->frame_size : ENCODER_AUDIO_FRAME_SIZE));
+	}
 	
 	if (audio_codec_)
 		flush(audio_codec_, audio_stream_);
@@ -301,10 +545,21 @@ bool Encoder::initializeStream(AVMediaType type, AVStream **stream_ptr, AVCodecC
 		codec_context->time_base = settings().videoParams().timeBase();
 
 		// Custom options
-		codec_context->bit_rate = 4 * 1000 * 1000 * 8;
+		codec_context->bit_rate = settings().videoBitrate();
 //		codec_context->rc_min_rate = 8 * 1000 * 1000;
-		codec_context->rc_max_rate = 2 * 1000 * 1000 * 16;
-		codec_context->rc_buffer_size = 4 * 1000 * 1000 / 2;
+		codec_context->rc_max_rate = settings().videoMaxBitrate();
+		codec_context->rc_buffer_size = settings().videoBufferSize();
+
+		if (!settings().videoPreset().empty())
+			av_opt_set(codec_context->priv_data, "preset", settings().videoPreset().c_str(), 0);
+
+		// Live output, no frame lookahead & a keyframe each second so a client can join
+		if (settings().isLowDelay()) {
+			av_opt_set(codec_context->priv_data, "tune", "zerolatency", 0);
+
+			codec_context->max_b_frames = 0;
+			codec_context->gop_size = MAX(1, (int) round(1.0 / av_q2d(codec_context->time_base)));
+		}
 
 // codec/ffmpeg/ffmpegencoder.cpp:503
 //				enc_ctx->flags |= AV_CODEC_FLAG_INTERLACED_DCT | AV_CODEC_FLAG_INTERLACED_ME;
@@ -358,17 +613,137 @@ bool Encoder::initializeStream(AVMediaType type, AVStream **stream_ptr, AVCodecC
 }
 
 
-bool Encoder::writeAudio(FramePtr frame, AVRational time) {
+bool Encoder::initializeResampler(AVFrame *frame) {
+	int result;
+
+	uint64_t channel_layout;
+
+	log_call();
+
+	channel_layout = frame->channel_layout ? frame->channel_layout : av_get_default_channel_layout(frame->channels);
+
+	// Decoded format, rate & layout to encoder input
+	swr_ctx_ = swr_alloc_set_opts(NULL,
+		audio_codec_->channel_layout,
+		audio_codec_->sample_fmt,
+		audio_codec_->sample_rate,
+		channel_layout,
+		(AVSampleFormat) frame->format,
+		frame->sample_rate,
+		0,
+		NULL);
+
+	if ((swr_ctx_ == NULL) || ((result = swr_init(swr_ctx_)) < 0)) {
+		av_log(NULL, AV_LOG_ERROR, "Failed to initialize audio resampler\n");
+		return false;
+	}
+
+	audio_fifo_ = av_audio_fifo_alloc(audio_codec_->sample_fmt, audio_codec_->channels, MAX(1, audio_codec_->frame_size));
+
+	if (audio_fifo_ == NULL) {
+		av_log(NULL, AV_LOG_ERROR, "Failed to allocate audio FIFO\n");
+		return false;
+	}
+
+	return true;
+}
+
+
+bool Encoder::resample(AVFrame *frame) {
+	int nb_samples;
+
+	uint8_t **data = NULL;
+
+	// NULL frame drains resampler
+	nb_samples = swr_get_out_samples(swr_ctx_, frame ? frame->nb_samples : 0);
+
+	if (nb_samples <= 0)
+		return true;
+
+	if (av_samples_alloc_array_and_samples(&data, NULL, audio_codec_->channels, nb_samples, audio_codec_->sample_fmt, 0) < 0)
+		return false;
+
+	nb_samples = swr_convert(swr_ctx_, data, nb_samples, 
+		frame ? (const uint8_t **) frame->extended_data : NULL, 
+		frame ? frame->nb_samples : 0);
+
+	if (nb_samples > 0)
+		av_audio_fifo_write(audio_fifo_, (void **) data, nb_samples);
+
+	av_freep(&data[0]);
+	av_freep(&data);
+
+	return (nb_samples >= 0);
+}
+
+
+bool Encoder::writeAudioSamples(int nb_samples) {
 	bool success = false;
 
-	AVFrame *encoded_frame = (AVFrame *) frame->data();
+	AVFrame *encoded_frame = av_frame_alloc();
+
+	encoded_frame->nb_samples = nb_samples;
+	encoded_frame->format = audio_codec_->sample_fmt;
+	encoded_frame->channel_layout = audio_codec_->channel_layout;
+	encoded_frame->sample_rate = audio_codec_->sample_rate;
 
-	(void) time;
+	if (av_frame_get_buffer(encoded_frame, 0) < 0)
+		goto fail;
+
+	if (av_audio_fifo_read(audio_fifo_, (void **) encoded_frame->data, nb_samples) < nb_samples)
+		goto fail;
+
+	// Sample accurate timestamps (audio codec time base is 1 / sample rate)
+	encoded_frame->pts = audio_next_pts_;
+	audio_next_pts_ += nb_samples;
 
 	success = writeAVFrame(encoded_frame, audio_codec_, audio_stream_);
 
+fail:
 	av_frame_free(&encoded_frame);
 
+	return success;
+}
+
+
+bool Encoder::writeAudio(FramePtr frame, AVRational time) {
+	bool success = true;
+
+	int frame_size = (audio_codec_->frame_size > 0) ? audio_codec_->frame_size : ENCODER_AUDIO_FRAME_SIZE;
+
+	AVFrame *decoded_frame = (AVFrame *) frame->data();
+
+	// Audio before first video frame is dropped
+	if (!started_)
+		goto skip;
+
+	time = av_sub_q(time, start_time_);
+
+	if (av_cmp_q(time, av_make_q(0, 1)) < 0)
+		goto skip;
+
+	// First samples anchor audio timeline, then it's counted in samples
+	if (swr_ctx_ == NULL) {
+		if (initializeResampler(decoded_frame) == false) {
+			success = false;
+			goto skip;
+		}
+
+		audio_next_pts_ = (int64_t) round(av_q2d(time) / av_q2d(audio_codec_->time_base));
+	}
+
+	if (resample(decoded_frame) == false) {
+		success = false;
+		goto skip;
+	}
+
+	// Encode each full frame
+	while (success && (av_audio_fifo_size(audio_fifo_) >= frame_size))
+		success = writeAudioSamples(frame_size);
+
+skip:
+	av_frame_free(&decoded_frame);
+
 	frame->setData(NULL);
 
 	return success;
@@ -440,7 +815,14 @@ bool Encoder::writeFrame(FramePtr frame, AVRational time) {
 		goto fail;
 	}
 
-	// TODO	
+	// Output timestamps are rebased on the first video frame
+	if (!started_) {
+		start_time_ = time;
+		started_ = true;
+	}
+
+	time = av_sub_q(time, start_time_);
+
 	encoded_frame->pts = (uint64_t) round(av_q2d(time) / av_q2d(video_codec_->time_base));
 //	encoded_frame->pts = (uint64_t) round(av_q2d(time));
 
@@ -483,7 +865,11 @@ bool Encoder::writeAVFrame(AVFrame *frame, AVCodecContext *codec_ctx, AVStream *
         av_packet_rescale_ts(packet, codec_ctx->time_base, stream->time_base);
 
 		// Mux encoded frame
-        av_interleaved_write_frame(fmt_ctx_, packet);
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			av_interleaved_write_frame(fmt_ctx_, packet);
+		}
 
 		// Unref packet in case we're getting another
 		av_packet_unref(packet);
@@ -4,10 +4,14 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <list>
+#include <mutex>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
+#include <libavutil/audio_fifo.h>
+#include <libswresample/swresample.h>
 #include <libswscale/swscale.h>
 }
 
@@ -16,6 +20,10 @@ extern "C" {
 #include "frame.h"
 
 
+// Audio frame size if codec doesn't set one
+#define ENCODER_AUDIO_FRAME_SIZE 1024
+
+
 class EncoderSettings {
 public:
 	EncoderSettings();
@@ -31,9 +39,16 @@ public:
 	void setAudioParams(const AudioParams &audio_params, AVCodecID codec_id);
 
 	bool isVideoEnabled(void) const;
+	const int64_t& videoBitrate(void) const;
 	void setVideoBitrate(const int64_t rate);
+	const int64_t& videoMaxBitrate(void) const;
 	void setVideoMaxBitrate(const int64_t rate);
+	const int64_t& videoBufferSize(void) const;
 	void setVideoBufferSize(const int64_t size);
+	const std::string& videoPreset(void) const;
+	void setVideoPreset(const std::string &preset);
+	bool isLowDelay(void) const;
+	void setLowDelay(bool enable);
 
 	bool isAudioEnabled(void) const;
 	void setAudioBitrate(const int64_t rate);
@@ -47,6 +62,8 @@ private:
 	int64_t video_bit_rate_;
 	int64_t video_max_bit_rate_;
 	int64_t video_buffer_size_;
+	std::string video_preset_;
+	bool low_delay_;
 
 	bool audio_enabled_;
 	AudioParams audio_params_;
@@ -60,6 +77,7 @@ public:
 	virtual ~Encoder();
 
 	static Encoder * create(const EncoderSettings &settings);
+	static bool concat(const std::list<std::string> &filenames, const std::string &filename);
 
 	const EncoderSettings& settings() const;
 
@@ -77,12 +95,19 @@ private:
 
 	bool initializeStream(AVMediaType type, AVStream **stream_ptr, AVCodecContext **codec_context_ptr, AVCodecID codec_id);
 
+	bool initializeResampler(AVFrame *frame);
+	bool resample(AVFrame *frame);
+	bool writeAudioSamples(int nb_samples);
+
 	bool writeAVFrame(AVFrame *frame, AVCodecContext *codec_ctx, AVStream *stream);
 
 	EncoderSettings settings_;
 
 	bool open_;
 
+	bool started_;
+	AVRational start_time_;
+
 	AVFormatContext *fmt_ctx_;
 
 	AVStream *video_stream_;
@@ -91,6 +116,14 @@ private:
 	AVStream *audio_stream_;
 	AVCodecContext *audio_codec_;
 
+	// Audio is resampled then queued up to a full encoder frame
+	SwrContext *swr_ctx_;
+	AVAudioFifo *audio_fifo_;
+	int64_t audio_next_pts_;
+
+	// Audio & video are muxed from distinct threads
+	std::mutex mutex_;
+
 	SwsContext *sws_ctx_;
 	SwsContext *alpha_sws_ctx_;
 	SwsContext *noalpha_sws_ctx_;
@@ -0,0 +1,444 @@
+#include <fstream>
+#include <algorithm>
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "log.h"
+#include "fitreader.h"
+
+
+// Base types: size, signed, invalid value is 0 ('z' types)
+static const struct {
+	uint8_t size;
+	bool is_signed;
+	bool zero_invalid;
+} base_types[] = {
+	{ 1, false, false },	// enum
+	{ 1, true,  false },	// sint8
+	{ 1, false, false },	// uint8
+	{ 2, true,  false },	// sint16
+	{ 2, false, false },	// uint16
+	{ 4, true,  false },	// sint32
+	{ 4, false, false },	// uint32
+	{ 0, false, false },	// string
+	{ 0, false, false },	// float32
+	{ 0, false, false },	// float64
+	{ 1, false, true  },	// uint8z
+	{ 2, false, true  },	// uint16z
+	{ 4, false, true  },	// uint32z
+	{ 1, false, false },	// byte
+	{ 8, true,  false },	// sint64
+	{ 8, false, false },	// uint64
+	{ 8, false, true  },	// uint64z
+};
+
+// CRC-16 (FIT SDK nibble table)
+static const uint16_t crc_table[16] = {
+	0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+	0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400,
+};
+
+static const char *sports[] = {
+	"generic", "running", "cycling", "transition", "fitness_equipment",
+	"swimming", "basketball", "soccer", "tennis", "american_football",
+	"training", "walking", "cross_country_skiing", "alpine_skiing", "snowboarding",
+	"rowing", "mountaineering", "hiking", "multisport", "paddling",
+};
+
+
+FITReader::FITReader(GPXStore *store)
+	: store_(store)
+	, timestamp_(0)
+	, nbr_messages_(0) {
+	for (int i=0; i<FIT_LOCAL_MESGS; i++)
+		definitions_[i].valid = false;
+}
+
+
+FITReader::~FITReader() {
+}
+
+
+bool FITReader::probe(const std::string &filename) {
+	char header[12];
+
+	std::ifstream stream(filename, std::ios::binary);
+
+	if (!stream.read(header, sizeof(header)))
+		return false;
+
+	return (memcmp(header + 8, ".FIT", 4) == 0);
+}
+
+
+bool FITReader::read(const std::string &filename, GPXStore *store) {
+	int fd;
+
+	bool result = false;
+
+	struct stat st;
+
+	const uint8_t *data = (const uint8_t *) MAP_FAILED;
+
+	FITReader reader(store);
+
+	log_call();
+
+	if ((fd = ::open(filename.c_str(), O_RDONLY)) < 0) {
+		log_error("Open '%s' FIT file failure, please check that file is readable", filename.c_str());
+		goto done;
+	}
+
+	if ((fstat(fd, &st) != 0) || (st.st_size == 0))
+		goto done;
+
+	// Decoded in one sequential pass, pages are read as they're reached
+	data = (const uint8_t *) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (data == MAP_FAILED)
+		goto done;
+
+	madvise((void *) data, st.st_size, MADV_SEQUENTIAL);
+
+	if ((result = reader.parse(data, st.st_size)) == false)
+		log_error("Parsing of '%s' failed, FIT file is corrupted", filename.c_str());
+
+done:
+	if (data != MAP_FAILED)
+		munmap((void *) data, st.st_size);
+	if (fd >= 0)
+		::close(fd);
+
+	return result;
+}
+
+
+uint16_t FITReader::crc16(const uint8_t *data, size_t size, uint16_t crc) {
+	size_t i;
+
+	uint16_t tmp;
+
+	for (i=0; i<size; i++) {
+		// Lower nibble, then upper nibble
+		tmp = crc_table[crc & 0x0F];
+		crc = (crc >> 4) & 0x0FFF;
+		crc = crc ^ tmp ^ crc_table[data[i] & 0x0F];
+
+		tmp = crc_table[crc & 0x0F];
+		crc = (crc >> 4) & 0x0FFF;
+		crc = crc ^ tmp ^ crc_table[(data[i] >> 4) & 0x0F];
+	}
+
+	return crc;
+}
+
+
+bool FITReader::parse(const uint8_t *data, size_t size) {
+	size_t pos = 0;
+	size_t begin, start, end;
+	size_t message;
+
+	bool truncated;
+
+	uint8_t header;
+	uint8_t local;
+	uint8_t offset;
+
+	uint16_t checksum;
+
+	uint32_t timestamp;
+
+	// A FIT file can hold several chained FIT files
+	while (pos + 12 <= size) {
+		if ((data[pos] < 12) || memcmp(data + pos + 8, ".FIT", 4))
+			return false;
+
+		// Truncated in a chained file header, keep what's decoded
+		if (pos + data[pos] > size) {
+			log_warn("FIT file is truncated");
+			break;
+		}
+
+		// Header CRC is optional (14 bytes header, 0 if not computed)
+		if (data[pos] >= 14) {
+			checksum = data[pos + 12] | (data[pos + 13] << 8);
+
+			if ((checksum != 0) && (checksum != crc16(data + pos, 12))) {
+				log_warn("FIT file header CRC mismatch");
+				return false;
+			}
+		}
+
+		begin = pos;
+		start = pos + data[pos];
+		end = start + (data[pos + 4] | (data[pos + 5] << 8) | (data[pos + 6] << 16) | ((uint32_t) data[pos + 7] << 24));
+
+		if ((truncated = (end + 2 > size)) == true) {
+			log_warn("FIT file is truncated, decoding stops at the last complete message");
+			end = std::min(end, size);
+		}
+		else {
+			// File CRC covers header & data, data is still checked message by message
+			checksum = data[end] | (data[end + 1] << 8);
+
+			if (checksum != crc16(data + begin, end - begin))
+				log_warn("FIT file CRC mismatch, file might be corrupted");
+		}
+
+		for (int i=0; i<FIT_LOCAL_MESGS; i++)
+			definitions_[i].valid = false;
+
+		for (pos=start; pos<end; ) {
+			message = pos;
+			header = data[pos++];
+
+			if (header & 0x80) {
+				// Compressed timestamp header: 5 bits offset on the last timestamp
+				local = (header >> 5) & 0x03;
+				offset = header & 0x1F;
+
+				timestamp = (timestamp_ & ~0x1F) + offset;
+
+				if (offset < (timestamp_ & 0x1F))
+					timestamp += 0x20;
+
+				timestamp_ = timestamp;
+
+				if (!decodeMessage(data, end, pos, local, timestamp))
+					goto failure;
+			}
+			else if (header & 0x40) {
+				if (!decodeDefinition(data, end, pos, header))
+					goto failure;
+			}
+			else {
+				if (!decodeMessage(data, end, pos, header & 0x0F, -1))
+					goto failure;
+			}
+		}
+
+		if (truncated)
+			break;
+
+		// CRC
+		pos = end + 2;
+	}
+
+	return true;
+
+failure:
+	// Last message is cut by the end of a truncated file
+	if (truncated) {
+		log_warn("FIT file is truncated, %lu bytes dropped", (unsigned long) (end - message));
+		return true;
+	}
+
+	return false;
+}
+
+
+bool FITReader::decodeDefinition(const uint8_t *data, size_t size, size_t &pos, uint8_t header) {
+	uint8_t i, n;
+
+	Definition &definition = definitions_[header & 0x0F];
+
+	// Reserved, architecture, global message number, number of fields
+	if (pos + 5 > size)
+		return false;
+
+	definition.big_endian = (data[pos + 1] == 1);
+	definition.global = definition.big_endian
+		? ((data[pos + 2] << 8) | data[pos + 3])
+		: (data[pos + 2] | (data[pos + 3] << 8));
+
+	n = data[pos + 4];
+	pos += 5;
+
+	if (pos + n * 3 > size)
+		return false;
+
+	definition.size = 0;
+	definition.fields.resize(n);
+
+	for (i=0; i<n; i++) {
+		definition.fields[i].num = data[pos];
+		definition.fields[i].size = data[pos + 1];
+		definition.fields[i].type = data[pos + 2];
+
+		definition.size += data[pos + 1];
+
+		pos += 3;
+	}
+
+	// Developer fields are skipped (only their size matters)
+	if (header & 0x20) {
+		if (pos + 1 > size)
+			return false;
+
+		n = data[pos++];
+
+		if (pos + n * 3 > size)
+			return false;
+
+		for (i=0; i<n; i++) {
+			definition.size += data[pos + 1];
+			pos += 3;
+		}
+	}
+
+	definition.valid = true;
+
+	return true;
+}
+
+
+bool FITReader::value(const uint8_t *p, const Field &field, bool big_endian, int64_t *value) {
+	int i;
+	int type = field.type & 0x1F;
+
+	uint64_t u = 0;
+	uint64_t invalid;
+
+	if (type >= (int) (sizeof(base_types) / sizeof(base_types[0])))
+		return false;
+
+	const int size = base_types[type].size;
+
+	if ((size == 0) || (size > field.size))
+		return false;
+
+	for (i=0; i<size; i++)
+		u |= (uint64_t) p[big_endian ? (size - 1 - i) : i] << (8 * i);
+
+	if (base_types[type].zero_invalid)
+		invalid = 0;
+	else if (base_types[type].is_signed)
+		invalid = (size == 8) ? 0x7FFFFFFFFFFFFFFFULL : ((1ULL << (8 * size - 1)) - 1);
+	else
+		invalid = (size == 8) ? ~0ULL : ((1ULL << (8 * size)) - 1);
+
+	if (u == invalid)
+		return false;
+
+	// Sign extension
+	if (base_types[type].is_signed && (size < 8) && (u & (1ULL << (8 * size - 1))))
+		u |= ~0ULL << (8 * size);
+
+	*value = (int64_t) u;
+
+	return true;
+}
+
+
+bool FITReader::decodeMessage(const uint8_t *data, size_t size, size_t &pos, uint8_t local, int64_t timestamp) {
+	int64_t v;
+
+	bool has_lat = false, has_lon = false;
+	bool has_enhanced = false;
+
+	double lat = 0.0, lon = 0.0, ele = 0.0;
+	double temperature = NAN;
+	int cadence = GPXSTORE_NO_VALUE;
+	int heartrate = GPXSTORE_NO_VALUE;
+	int power = GPXSTORE_NO_VALUE;
+	int event = -1, event_type = -1;
+
+	const uint8_t *p;
+
+	const Definition &definition = definitions_[local];
+
+	if (!definition.valid || (pos + definition.size > size))
+		return false;
+
+	p = data + pos;
+	pos += definition.size;
+
+	nbr_messages_++;
+
+	for (const Field &field : definition.fields) {
+		if (!value(p, field, definition.big_endian, &v)) {
+			p += field.size;
+			continue;
+		}
+
+		p += field.size;
+
+		if (field.num == FIT_FIELD_TIMESTAMP) {
+			timestamp_ = v;
+			timestamp = v;
+			continue;
+		}
+
+		switch (definition.global) {
+		case FIT_MESG_RECORD:
+			switch (field.num) {
+			case FIT_RECORD_LAT:
+				// Semicircles
+				lat = v * (180.0 / 2147483648.0);
+				has_lat = true;
+				break;
+			case FIT_RECORD_LON:
+				lon = v * (180.0 / 2147483648.0);
+				has_lon = true;
+				break;
+			case FIT_RECORD_ALTITUDE:
+				if (!has_enhanced)
+					ele = (v / 5.0) - 500.0;
+				break;
+			case FIT_RECORD_ENHANCED_ALTITUDE:
+				ele = (v / 5.0) - 500.0;
+				has_enhanced = true;
+				break;
+			case FIT_RECORD_HEARTRATE:
+				heartrate = v;
+				break;
+			case FIT_RECORD_CADENCE:
+				cadence = v;
+				break;
+			case FIT_RECORD_POWER:
+				power = v;
+				break;
+			case FIT_RECORD_TEMPERATURE:
+				temperature = v;
+				break;
+			}
+			break;
+
+		case FIT_MESG_EVENT:
+			if (field.num == FIT_EVENT_EVENT)
+				event = v;
+			else if (field.num == FIT_EVENT_TYPE)
+				event_type = v;
+			break;
+
+		case FIT_MESG_SESSION:
+			if ((field.num == FIT_SESSION_SPORT) && (v >= 0) && (v < (int64_t) (sizeof(sports) / sizeof(sports[0]))))
+				store_->setInfo("type", sports[v]);
+			break;
+		}
+	}
+
+	switch (definition.global) {
+	case FIT_MESG_RECORD:
+		// Skip record without time or position (indoor, no GPS fix yet)
+		if ((timestamp < 0) || !has_lat || !has_lon)
+			break;
+
+		store_->append(nbr_messages_, (timestamp + FIT_EPOCH) * 1000, lat, lon, ele,
+			temperature, cadence, heartrate, power);
+		break;
+
+	case FIT_MESG_EVENT:
+		// Timer stopped: next records start a new segment
+		if ((event == FIT_EVENT_TIMER) && ((event_type == FIT_EVENT_TYPE_STOP) || (event_type == FIT_EVENT_TYPE_STOP_ALL)))
+			store_->split();
+		break;
+	}
+
+	return true;
+}
+
@@ -0,0 +1,92 @@
+#ifndef __GPX2VIDEO__FITREADER_H__
+#define __GPX2VIDEO__FITREADER_H__
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "gpxstore.h"
+
+
+// FIT epoch (1989-12-31 00:00:00 UTC) in UNIX time
+#define FIT_EPOCH 631065600
+
+// Global message numbers
+#define FIT_MESG_SESSION 18
+#define FIT_MESG_RECORD 20
+#define FIT_MESG_EVENT 21
+
+// Record message fields
+#define FIT_RECORD_LAT 0
+#define FIT_RECORD_LON 1
+#define FIT_RECORD_ALTITUDE 2
+#define FIT_RECORD_HEARTRATE 3
+#define FIT_RECORD_CADENCE 4
+#define FIT_RECORD_POWER 7
+#define FIT_RECORD_TEMPERATURE 13
+#define FIT_RECORD_ENHANCED_ALTITUDE 78
+#define FIT_FIELD_TIMESTAMP 253
+
+// Event message fields & values
+#define FIT_EVENT_EVENT 0
+#define FIT_EVENT_TYPE 1
+#define FIT_EVENT_TIMER 0
+#define FIT_EVENT_TYPE_STOP 1
+#define FIT_EVENT_TYPE_STOP_ALL 4
+
+// Session message fields
+#define FIT_SESSION_SPORT 5
+
+#define FIT_LOCAL_MESGS 16
+
+
+/**
+ * Garmin FIT (Flexible & Interoperable data Transfer) decoder.
+ * Definition & data messages are decoded in one pass over the mapped file,
+ * record messages go straight to the track store columns.
+ */
+class FITReader {
+public:
+	virtual ~FITReader();
+
+	static bool probe(const std::string &filename);
+	static bool read(const std::string &filename, GPXStore *store);
+
+private:
+	struct Field {
+		uint8_t num;
+		uint8_t size;
+		uint8_t type;
+	};
+
+	struct Definition {
+		bool valid;
+		bool big_endian;
+		uint16_t global;
+		size_t size;
+		std::vector<Field> fields;
+	};
+
+	FITReader(GPXStore *store);
+
+	bool parse(const uint8_t *data, size_t size);
+
+	bool decodeDefinition(const uint8_t *data, size_t size, size_t &pos, uint8_t header);
+	bool decodeMessage(const uint8_t *data, size_t size, size_t &pos, uint8_t local, int64_t timestamp);
+
+	static bool value(const uint8_t *p, const Field &field, bool big_endian, int64_t *value);
+
+	static uint16_t crc16(const uint8_t *data, size_t size, uint16_t crc=0);
+
+	GPXStore *store_;
+
+	Definition definitions_[FIT_LOCAL_MESGS];
+
+	// Last full timestamp (for compressed timestamp headers)
+	uint32_t timestamp_;
+
+	unsigned int nbr_messages_;
+};
+
+#endif
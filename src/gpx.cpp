@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -7,37 +8,10 @@
 #include <time.h>
 #include <math.h>
 
-#include "utmconvert/utmconvert.h"
-#include <GeographicLib/Geodesic.hpp>
-
-
-#include "gpxlib/Parser.h"
-#include "gpxlib/ReportCerr.h"
-
 #include "log.h"
 #include "gpx.h"
 
 
-void show(gpx::Node &node, unsigned width)
-{
-	std::string value(width, ' ');
-
-  value = node.getValue();
-
-  if (value.length() > width)
-  {
-    value = value.substr(0, width);
-  }
-  else if (value.length() < width)
-  {
-    value.insert(0, width - value.length(), ' ');
-  }
-
-  std::cout << value << ' ';
-}
-
-
-
 #define NOISE 0.1
 
 
@@ -47,6 +21,8 @@ void show(gpx::Node &node, unsigned width)
 GPXData::GPXData() 
 	: enable_(false)
 	, has_value_(false)
+	, store_(NULL)
+	, index_(0)
 	, nbr_points_(0)
 	, line_(0)
 	, valid_(false)
@@ -57,16 +33,14 @@ GPXData::GPXData()
 	, maxspeed_(0)
 	, avgspeed_(0)
 	, grade_(0) 
-	, cadence_(0) {
+	, cadence_(0)
+	, power_(0) {
 
 	nbr_predictions_ = 0;
-
-	filter_ = alloc_filter_velocity2d(10.0);
 }
 
 
 GPXData::~GPXData() {
-//	free_filter(filter_);
 }
 
 
@@ -87,87 +61,26 @@ void GPXData::dump(void) {
 }
 
 
-void GPXData::convert(struct GPXData::point *pt, gpx::WPT *wpt) {
-	const char *s;
-
-	struct tm time;
-
-	struct Utm_val utm;
-
-	pt->valid = true;
-
-	// Convert time - GPX file contains UTC time
-	s = wpt->time().getValue().c_str();
-
-	// Try format: "2020:12:13 08:55:48.215"
-	memset(&time, 0, sizeof(time));
-	if (strptime(s, "%Y:%m:%d %H:%M:%S.", &time) != NULL)
-		pt->time = timegm(&time);
-	// Try format: "2020-07-28T07:04:43.000Z"
-	else if (strptime(s, "%Y-%m-%dT%H:%M:%S.", &time) != NULL)
-		pt->time = timegm(&time);
-	// Try format: "2020-07-28T07:04:43Z"
-	else if (strptime(s, "%Y-%m-%dT%H:%M:%SZ", &time) != NULL)
-		pt->time = timegm(&time);
-	else
-		pt->valid = false;
-
-	// Convert lat, lon & ele
-	pt->lat = (double) wpt->lat();
-	pt->lon = (double) wpt->lon();
-	pt->ele = (double) wpt->ele();
-
-	utm = to_utm(pt->lat, pt->lon);
-
-	// Return result
-	pt->x = utm.x;
-	pt->y = utm.y;
-}
-
-
 bool GPXData::compute(void) {
-	if (!enable_)
+	if (!enable_ || (store_ == NULL))
 		return true;
 
-//	double dx = (cur_pt_.x - prev_pt_.x);
-//	double dy = (cur_pt_.y - prev_pt_.y);
-	double dz = (cur_pt_.ele - prev_pt_.ele);
-
-//	double dc = sqrt(dx*dx + dy*dy + dz*dz);
-
-	double dc;
-
-	double speed = 0;
-
-	GeographicLib::Math::real lat1 = cur_pt_.lat;
-	GeographicLib::Math::real lon1 = cur_pt_.lon;
-	GeographicLib::Math::real lat2 = prev_pt_.lat;
-	GeographicLib::Math::real lon2 = prev_pt_.lon;
-	GeographicLib::Math::real d;
-
-	GeographicLib::Geodesic gsic(6378388, 1/297.0);
-	gsic.Inverse(lat1, lon1, lat2, lon2,
-		d);
-
-	dc = d;
-
-	double dt = difftime(cur_pt_.time, prev_pt_.time);
+	// Distance, speed & grade are precomputed per point by the store
+	double dc = cur_pt_.distance - prev_pt_.distance;
+	double dt = (cur_pt_.time_ms - prev_pt_.time_ms) / 1000.0;
 
 	// distance_ in meter
 	// duration_ in second
 	duration_ += dt;
 	distance_ += dc;
-	if (dt > 0)
-		speed = (3600.0 * dc) / (1000.0 * dt);
-	if (abs((int) (speed - speed_)) < 50)
-		speed_ = speed;
-	if (speed_ > maxspeed_)
-		maxspeed_ = speed_;
-	avgspeed_ = (3600.0 * distance_) / (1000.0 * duration_);
 
-//	dc = sqrt(dx*dx + dy*dy);
+	speed_ = store_->speed(index_);
+	grade_ = store_->grade(index_);
 
-	grade_ = 100 * dz / dc;
+	if (speed_ > maxspeed_)
+		maxspeed_ = speed_;
+	if (duration_ > 0)
+		avgspeed_ = (3600.0 * distance_) / (1000.0 * duration_);
 
 	has_value_ = true;
 
@@ -197,12 +110,11 @@ void GPXData::reset(void) {
 	temperature_ = 0.0;
 	heartrate_ = 0;
 	cadence_ = 0;
+	power_ = 0;
 }
 
 
 void GPXData::predict(enum TelemetrySettings::Filter filter) {
-	struct Utm_val utm;
-
 	struct point prev_pt;
 
 	nbr_predictions_++;
@@ -211,13 +123,15 @@ void GPXData::predict(enum TelemetrySettings::Filter filter) {
 	memcpy(&prev_pt, &prev_pt_, sizeof(prev_pt));
 	memcpy(&prev_pt_, &cur_pt_, sizeof(prev_pt_));
 
-	cur_pt_.time += 1; // Prediction should occur each 1 second
+	// Prediction should occur each 1 second
+	cur_pt_.time_ms += 1000;
+	cur_pt_.time = cur_pt_.time_ms / 1000;
 
 	switch (filter) {
 	case TelemetrySettings::FilterKalman:
 		// Predict
-		::update(filter_);
-		::get_lat_long(filter_, &cur_pt_.lat, &cur_pt_.lon);
+		filter_.update();
+		filter_.position(&cur_pt_.lat, &cur_pt_.lon);
 		break;
 
 	case TelemetrySettings::FilterLinear:
@@ -227,9 +141,15 @@ void GPXData::predict(enum TelemetrySettings::Filter filter) {
 		break;
 
 	case TelemetrySettings::FilterInterpolate:
-		cur_pt_.lat += (next_pt_.lat - prev_pt_.lat) / (next_pt_.time - prev_pt_.time);
-		cur_pt_.lon += (next_pt_.lon - prev_pt_.lon) / (next_pt_.time - prev_pt_.time);
-		cur_pt_.ele += (next_pt_.ele - prev_pt_.ele) / (next_pt_.time - prev_pt_.time);
+	case TelemetrySettings::FilterSmooth:
+		// 1 second step toward next point (points may share the same second)
+		if (next_pt_.time_ms > prev_pt_.time_ms) {
+			double f = std::min(1000.0 / (next_pt_.time_ms - prev_pt_.time_ms), 1.0);
+
+			cur_pt_.lat += f * (next_pt_.lat - prev_pt_.lat);
+			cur_pt_.lon += f * (next_pt_.lon - prev_pt_.lon);
+			cur_pt_.ele += f * (next_pt_.ele - prev_pt_.ele);
+		}
 		break;
 
 	case TelemetrySettings::FilterNone:
@@ -238,10 +158,17 @@ void GPXData::predict(enum TelemetrySettings::Filter filter) {
 	}
 
 	if (filter != TelemetrySettings::FilterNone) {
-		utm = to_utm(cur_pt_.lat, cur_pt_.lon);
+		// Track distance at predicted time
+		if ((store_ != NULL) && (index_ > 0)) {
+			double t0 = store_->time(index_ - 1);
+			double t1 = store_->time(index_);
+			double f = (t1 > t0) ? (cur_pt_.time_ms - t0) / (t1 - t0) : 1.0;
+
+			f = std::min(std::max(f, 0.0), 1.0);
 
-		cur_pt_.x = utm.x;
-		cur_pt_.y = utm.y;
+			cur_pt_.distance = store_->distance(index_ - 1) 
+				+ f * (store_->distance(index_) - store_->distance(index_ - 1));
+		}
 
 		compute();
 	}
@@ -262,14 +189,15 @@ void GPXData::update(enum TelemetrySettings::Filter filter) {
 		memcpy(&cur_pt_, &next_pt_, sizeof(cur_pt_));
 
 		// Correct
-		::update_velocity2d(filter_, next_pt_.lat, next_pt_.lon, 1.0);
+		filter_.update(next_pt_.lat, next_pt_.lon, 1.0);
 
 		// Filter
-		::get_lat_long(filter_, &cur_pt_.lat, &cur_pt_.lon);
+		filter_.position(&cur_pt_.lat, &cur_pt_.lon);
 		break;
 	
 	case TelemetrySettings::FilterLinear:
 	case TelemetrySettings::FilterInterpolate:
+	case TelemetrySettings::FilterSmooth:
 	case TelemetrySettings::FilterNone:
 	default:
 		memcpy(&cur_pt_, &next_pt_, sizeof(cur_pt_));
@@ -280,8 +208,10 @@ void GPXData::update(enum TelemetrySettings::Filter filter) {
 	if (enable_)
 		elapsedtime_ += (cur_pt_.time - prev_pt_.time);
 
-	if (filter == TelemetrySettings::FilterNone)
+	if (filter == TelemetrySettings::FilterNone) {
 		prev_pt_.time -= nbr_predictions_;
+		prev_pt_.time_ms -= nbr_predictions_ * 1000;
+	}
 
 	compute();
 
@@ -289,36 +219,41 @@ void GPXData::update(enum TelemetrySettings::Filter filter) {
 }
 
 
-void GPXData::read(gpx::WPT *wpt) {
+void GPXData::read(const GPXStore &store, size_t i, enum TelemetrySettings::Filter filter) {
 	struct point pt;
 
-	convert(&pt, wpt);
+	pt.valid = true;
+	pt.time_ms = store.time(i);
+	pt.time = pt.time_ms / 1000;
+	pt.distance = store.distance(i);
 
-	// Skip point if not valid
-	if (!pt.valid)
-		return;
+	// Smoothed once for the whole track, nothing to filter per frame
+	if (filter == TelemetrySettings::FilterSmooth) {
+		pt.lat = store.smoothLat(i);
+		pt.lon = store.smoothLon(i);
+		pt.ele = store.smoothEle(i);
+	}
+	else {
+		pt.lat = store.lat(i);
+		pt.lon = store.lon(i);
+		pt.ele = store.ele(i);
+	}
+
+	store_ = &store;
+	index_ = i;
 
 	// Line
-	line_ = wpt->line();
+	line_ = store.line(i);
 
 	// Extensions
-	gpx::Node *extensions = wpt->extensions().getElements().front();
-
-	if (extensions) {
-		for (std::list<gpx::Node*>::const_iterator iter = extensions->getElements().begin(); 
-			iter != extensions->getElements().end(); ++iter) {
-			gpx::Node *node = (*iter);
-
-			std::string name = node->getName();
-
-			if (name.find("atemp") != std::string::npos)
-				temperature_ = std::stod(node->getValue());
-			else if (name.find("cad") != std::string::npos)
-				cadence_ = std::stoi(node->getValue());
-			else if (name.find("hr") != std::string::npos)
-				heartrate_ = std::stoi(node->getValue());
-		}
-	}
+	if (store.hasTemperature(i))
+		temperature_ = store.temperature(i);
+	if (store.hasCadence(i))
+		cadence_ = store.cadence(i);
+	if (store.hasHeartrate(i))
+		heartrate_ = store.heartrate(i);
+	if (store.hasPower(i))
+		power_ = store.power(i);
 
 	// Save point
 	memcpy(&next_pt_, &pt, sizeof(next_pt_));
@@ -330,10 +265,9 @@ void GPXData::read(gpx::WPT *wpt) {
 // GPX File Reader
 //-----------------
 
-GPX::GPX(std::ifstream &stream, gpx::GPX *root, enum TelemetrySettings::Filter filter) 
-	: stream_(stream)
-	, root_(root)
-	, trk_(NULL)
+GPX::GPX(std::shared_ptr<const GPXStore> store, enum TelemetrySettings::Filter filter) 
+	: store_(store)
+	, pos_(0)
 	, offset_(0) 
 	, from_(0)
 	, to_(0)
@@ -350,32 +284,21 @@ GPX::~GPX() {
 GPX * GPX::open(const std::string &filename, enum TelemetrySettings::Filter filter) {
 	GPX *gpx = NULL;
 
-	GPXData data;
-
-	gpx::GPX *root;
-//	gpx::ReportCerr report;
-	gpx::Parser parser(NULL); //&report);
+	std::shared_ptr<const GPXStore> store;
 
-    std::ifstream stream = std::ifstream(filename);
+	GPXData data;
 
-	if (!stream.is_open()) {
-		log_error("Open '%s' GPX file failure, please check that file is readable", filename.c_str());
+	// GPX file is parsed once, each GPX instance is a cursor on it
+	if ((store = GPXStore::get(filename)) == NULL)
 		goto failure;
-	}
-
-	root = parser.parse(stream);
 
-	if (root == NULL) {
-		log_error("Parsing of '%s' failed due to %s on line %d and column %d", 
-			filename.c_str(), parser.errorText().c_str(),
-			parser.errorLineNumber(), parser.errorColumnNumber());
-		goto failure;
-	}
+	gpx = new GPX(store, filter);
 
-	gpx = new GPX(stream, root, filter);
+	// Batch pass over the whole track, before any frame is rendered
+	if (filter == TelemetrySettings::FilterSmooth)
+		store->smooth();
 
 	// Parse activity start time
-	gpx->parse();
 	gpx->retrieveFirst(data);
 
 	gpx->start_activity_ = data.time();
@@ -390,32 +313,14 @@ failure:
 
 void GPX::dump(void) {
 	std::cout << "Track info:" << std::endl;
-	std::cout << "  Name        : " << trk_->name()  .getValue() << std::endl;
-	std::cout << "  Comment     : " << trk_->cmt()   .getValue() << std::endl;
-	std::cout << "  Description : " << trk_->desc()  .getValue() << std::endl;
-	std::cout << "  Source      : " << trk_->src()   .getValue() << std::endl;
-	std::cout << "  Type        : " << trk_->type()  .getValue() << std::endl;
-	std::cout << "  Number      : " << trk_->number().getValue() << std::endl;
-	std::cout << "  Segments:   : " << trk_->trksegs().list().size()  << std::endl;
-}
-
-
-bool GPX::parse(void) {
-	std::list<gpx::TRK*> &trks = root_->trks().list();
-
-	for (std::list<gpx::TRK *>::iterator node = trks.begin(); node != trks.end(); ++node) {
-		gpx::TRK *trk = (*node);
-         
-		if (trk == nullptr)
- 			continue;
-
-		trk_ = trk;
-
-		// Parse only the first track
-		break;
-	}
-
-	return true;
+	std::cout << "  Name        : " << store_->info("name") << std::endl;
+	std::cout << "  Comment     : " << store_->info("cmt") << std::endl;
+	std::cout << "  Description : " << store_->info("desc") << std::endl;
+	std::cout << "  Source      : " << store_->info("src") << std::endl;
+	std::cout << "  Type        : " << store_->info("type") << std::endl;
+	std::cout << "  Number      : " << store_->info("number") << std::endl;
+	std::cout << "  Segments:   : " << store_->segments().size()  << std::endl;
+	std::cout << "  Points:     : " << store_->size()  << std::endl;
 }
 
 
@@ -493,27 +398,15 @@ void GPX::setTimeOffset(const int& offset) {
 
 
 enum GPX::Data GPX::retrieveFirst_i(GPXData &data) {
-	gpx::WPT *wpt;
-	std::list<gpx::TRKSeg*> &trksegs = trk_->trksegs().list();
-
 	data = GPXData();
 
-	iter_seg_ = trksegs.begin();
-	
-	if (iter_seg_ != trksegs.end()) {
-		gpx::TRKSeg *trkseg = (*iter_seg_);
-
-		std::list<gpx::WPT*> &trkpts = trkseg->trkpts().list();
-		iter_pts_ = trkpts.begin();
+	pos_ = 0;
 
-		if (iter_pts_ != trkpts.end()) {
-			wpt = (*iter_pts_);
-
-			data.read(wpt);
-			data.init();
+	if (pos_ < store_->size()) {
+		data.read(*store_, pos_, filter_);
+		data.init();
 
-			return GPX::DataMeasured;
-		}
+		return GPX::DataMeasured;
 	}
 
 	return GPX::DataEof;
@@ -527,7 +420,7 @@ enum GPX::Data GPX::retrieveFirst(GPXData &data) {
 
 	if (from_ != 0) {
 		int64_t timecode_ms = (((int64_t) from_ - start_time_) * 1000) - offset_;
-		result = retrieveNext(data, timecode_ms);
+		result = seek(data, timecode_ms);
 
 		data.init();
 	}
@@ -536,10 +429,29 @@ enum GPX::Data GPX::retrieveFirst(GPXData &data) {
 }
 
 
+enum GPX::Data GPX::seek(GPXData &data, int64_t timecode_ms) {
+	int64_t timestamp = (int64_t) start_time_ * 1000 + offset_ + timecode_ms;
+
+	data = GPXData();
+
+	if (store_->empty())
+		return GPX::DataEof;
+
+	// Jump to the last point before timestamp (forward or backward)
+	pos_ = store_->find(timestamp);
+
+	data.read(*store_, pos_, filter_);
+	data.init();
+
+	return retrieveNext(data, timecode_ms);
+}
+
+
 enum GPX::Data GPX::retrieveNext(GPXData &data, int64_t timecode_ms) {
 	enum GPX::Data result = GPX::DataEof;
 
-	int64_t timestamp = start_time_ + ((offset_ + timecode_ms) / 1000);
+	// In ms: several points may share the same second
+	int64_t timestamp = (int64_t) start_time_ * 1000 + offset_ + timecode_ms;
 
 	do {
 		if (timecode_ms == -1) {
@@ -554,7 +466,7 @@ enum GPX::Data GPX::retrieveNext(GPXData &data, int64_t timecode_ms) {
 			result = GPX::DataMeasured;
 		}
 		else {
-			if ((from_ != 0) && (timestamp < from_)) {
+			if ((from_ != 0) && (timestamp < (int64_t) from_ * 1000)) {
 				data.disableCompute();
 				data.unvalid();
 
@@ -562,7 +474,7 @@ enum GPX::Data GPX::retrieveNext(GPXData &data, int64_t timecode_ms) {
 
 				break;
 			}
-			else if ((to_ != 0) && (timestamp > (to_ + (offset_ / 1000)))) {
+			else if ((to_ != 0) && (timestamp > ((int64_t) to_ * 1000 + offset_))) {
 				data.disableCompute();
 				data.unvalid();
 
@@ -570,42 +482,34 @@ enum GPX::Data GPX::retrieveNext(GPXData &data, int64_t timecode_ms) {
 
 				break;
 			}
-			else if (timestamp <= data.time(GPXData::PositionCurrent)) {
+			else if (timestamp <= data.timeMs(GPXData::PositionCurrent)) {
 				result = GPX::DataUnchanged;
 			}
-			else if (timestamp < data.time(GPXData::PositionNext)) {
-				data.predict(filter_);
-
-				result = GPX::DataPredicted;
-			}
-			else if (timestamp == data.time(GPXData::PositionNext)) {
+			else if ((timestamp >= data.timeMs(GPXData::PositionNext))
+					&& ((data.timeMs(GPXData::PositionCurrent) + 1000) >= data.timeMs(GPXData::PositionNext))) {
+				// Next point reached (and no full second to predict before it)
 				data.update(filter_);
 
 				if (this->retrieveData(data) == GPX::DataEof)
 					goto eof;
-		
+
 				result = GPX::DataMeasured;
 			}
-			else if (timestamp > data.time(GPXData::PositionNext)) {
-				if ((data.time(GPXData::PositionCurrent) + 1) >= data.time(GPXData::PositionNext)) {
-					data.update(filter_);
-				
-					if (this->retrieveData(data) == GPX::DataEof)
-						goto eof;
-				
-					result = GPX::DataMeasured;
-				}
-				else {
-					data.predict(filter_);
-				
-					result = GPX::DataPredicted;
-				}
+			else if (timestamp >= (data.timeMs(GPXData::PositionCurrent) + 1000)) {
+				data.predict(filter_);
+
+				result = GPX::DataPredicted;
+			}
+			else {
+				result = GPX::DataUnchanged;
 			}
 		}
 
 		if ((from_ == 0) || (from_ < data.time(GPXData::PositionCurrent)))
 			data.enableCompute();
-	} while (data.time(GPXData::PositionCurrent) < timestamp);
+	} while ((timecode_ms == -1) ? (data.timeMs(GPXData::PositionCurrent) < timestamp)
+		: ((timestamp > data.timeMs(GPXData::PositionCurrent))
+			&& ((timestamp >= data.timeMs(GPXData::PositionNext)) || (timestamp >= (data.timeMs(GPXData::PositionCurrent) + 1000)))));
 
 	return result;
 
@@ -618,33 +522,11 @@ eof:
 
 
 enum GPX::Data GPX::retrieveData(GPXData &data) {
-	gpx::WPT *wpt;
-	gpx::TRKSeg *trkseg = (*iter_seg_);
-
-	std::list<gpx::WPT*> &trkpts = trkseg->trkpts().list();
-	std::list<gpx::TRKSeg*> &trksegs = trk_->trksegs().list();
-
 	// Next point
-	iter_pts_++;
-
-	if (iter_pts_ == trkpts.end()) {
-		iter_seg_++;
-
-		if (iter_seg_ == trksegs.end())
-			goto done;
-
-		trkseg = (*iter_seg_);
-
-		trkpts = trkseg->trkpts().list();
-		iter_pts_ = trkpts.begin();
-	}
-
-	if (iter_pts_ == trkpts.end())
+	if (++pos_ >= store_->size())
 		goto done;
 
-	wpt = (*iter_pts_);
-
-	data.read(wpt);
+	data.read(*store_, pos_, filter_);
 
 	return GPX::DataMeasured;
 
@@ -656,91 +538,76 @@ done:
 
 
 enum GPX::Data GPX::retrieveLast(GPXData &data) {
-	gpx::WPT *wpt;
-	std::list<gpx::TRKSeg*> &trksegs = trk_->trksegs().list();
+	size_t first, last;
 
 	data = GPXData();
 
-	iter_seg_ = trksegs.end();
+	range(&first, &last);
 
-	if (!trksegs.empty()) {
-		do {
-			iter_seg_--;
-		
-			gpx::TRKSeg *trkseg = (*iter_seg_);
+	if (first >= last)
+		return GPX::DataEof;
 
-			std::list<gpx::WPT*> &trkpts = trkseg->trkpts().list();
-			iter_pts_ = trkpts.end();
+	pos_ = last - 1;
 
-			if (!trkpts.empty()) {
-				do {
-					iter_pts_--;
+	data.read(*store_, pos_, filter_);
+	data.init();
 
-					wpt = (*iter_pts_);
+	return GPX::DataMeasured;
+}
 
-					data.read(wpt);
 
-					if (to_ != 0) {
-						if (data.time(GPXData::PositionCurrent) < to_)
-							return GPX::DataMeasured;
-						else
-							continue;
-					}
+void GPX::range(size_t *first, size_t *last) {
+	const std::vector<int64_t> &times = store_->times();
 
-					return GPX::DataMeasured;
-				} while (iter_pts_ != trkpts.begin());
-			}
-		} while (iter_seg_ != trksegs.begin());
-	}
+	*first = 0;
+	*last = times.size();
 
-	return GPX::DataEof;
+	// Times are sorted: binary search of the first point at or after from_...
+	if (from_ != 0)
+		*first = std::lower_bound(times.begin(), times.end(), (int64_t) from_ * 1000) - times.begin();
+
+	// ... and of the first point past the second to_
+	if (to_ != 0)
+		*last = std::lower_bound(times.begin(), times.end(), ((int64_t) to_ + (offset_ / 1000) + 1) * 1000) - times.begin();
+
+	*last = std::max(*first, *last);
 }
 
 
 bool GPX::getBoundingBox(GPXData::point *p1, GPXData::point *p2) {
-	GPXData::point p;
+	size_t i, first, last;
 
-	std::list<gpx::TRKSeg*> &trksegs = trk_->trksegs().list();
+	const std::vector<double> &lats = store_->lats();
+	const std::vector<double> &lons = store_->lons();
 
 	p1->valid = false;
 	p2->valid = false;
 
-	for (std::list<gpx::TRKSeg*>::iterator iter2 = trksegs.begin(); iter2 != trksegs.end(); ++iter2) {
-		gpx::TRKSeg *seg = (*iter2);
-
-		std::list<gpx::WPT*> &trkpts = seg->trkpts().list();
-
-		for (std::list<gpx::WPT*>::iterator iter3 = trkpts.begin(); iter3 != trkpts.end(); ++iter3) {
-			gpx::WPT *wpt = (*iter3);
-
-			GPXData::convert(&p, wpt);
+	range(&first, &last);
 
-			if (!p.valid)
-				continue;
+	if (first >= last)
+		return false;
 
-			if ((from_ != 0) && (p.time < from_))
-				continue;
+	GPXData data;
 
-			if (!p1->valid)
-				*p1 = p;
-			if (!p2->valid)
-				*p2 = p;
+	data.read(*store_, first);
+	data.init();
 
-			// top-left bounding box
-			if (p.lon < p1->lon)
-				p1->lon = p.lon;
-			if (p.lat > p1->lat)
-				p1->lat = p.lat;
+	*p1 = data.position();
+	*p2 = data.position();
 
-			// bottom-right bounding box
-			if (p.lon > p2->lon)
-				p2->lon = p.lon;
-			if (p.lat < p2->lat)
-				p2->lat = p.lat;
+	for (i=first; i<last; i++) {
+		// top-left bounding box
+		if (lons[i] < p1->lon)
+			p1->lon = lons[i];
+		if (lats[i] > p1->lat)
+			p1->lat = lats[i];
 
-			if ((to_ != 0) && (p.time > to_))
-				break;
-		}
+		// bottom-right bounding box
+		if (lons[i] > p2->lon)
+			p2->lon = lons[i];
+		if (lats[i] < p2->lat)
+			p2->lat = lats[i];
 	}
 
 	return (p1->valid && p2->valid);
@@ -748,37 +615,14 @@ bool GPX::getBoundingBox(GPXData::point *p1, GPXData::point *p2) {
 
 
 double GPX::getMaxSpeed(void) {
-	GPXData data;
-
-	double max_speed = 0.0;
-	double last_speed = 0.0;
-
-	std::list<gpx::TRKSeg*> &trksegs = trk_->trksegs().list();
-
-	for (std::list<gpx::TRKSeg*>::iterator iter2 = trksegs.begin(); iter2 != trksegs.end(); ++iter2) {
-		gpx::TRKSeg *seg = (*iter2);
+	size_t first, last;
 
-		std::list<gpx::WPT*> &trkpts = seg->trkpts().list();
+	const std::vector<double> &speeds = store_->speeds();
 
-		for (std::list<gpx::WPT*>::iterator iter3 = trkpts.begin(); iter3 != trkpts.end(); ++iter3) {
-			gpx::WPT *wpt = (*iter3);
+	range(&first, &last);
 
-			data.read(wpt);
+	if (first >= last)
+		return 0.0;
 
-			if (!data.valid())
-				continue;
-
-			// Skip incoherent values
-			if (abs(last_speed - data.speed()) > 10)
-				continue;
-
-			if (data.speed() > max_speed)
-				max_speed = data.speed();
-
-			last_speed = data.speed();
-		}
-	}
-
-	return max_speed;
+	return *std::max_element(speeds.begin() + first, speeds.begin() + last);
 }
-
@@ -6,9 +6,8 @@
 #include <string>
 #include <vector>
 
-#include "kalman.h"
-#include "gpxlib/Parser.h"
-#include "gpxlib/ReportCerr.h"
+#include "gpxstore.h"
+#include "kalmanfilter.h"
 #include "telemetrysettings.h"
 
 
@@ -18,9 +17,10 @@ public:
 	struct point {
 		bool valid;
 		double lat, lon;
-		double x, y;
 		double ele;
-		time_t time;
+		double distance;	// Along the track, since its first point
+		time_t time;		// In seconds (time_ms / 1000)
+		int64_t time_ms;	// Sub-second points (GoPro GPS5 is 18 Hz)
 	};
 
 	enum Position {
@@ -37,7 +37,7 @@ public:
 	void predict(enum TelemetrySettings::Filter filter=TelemetrySettings::FilterNone);
 	void update(enum TelemetrySettings::Filter filter=TelemetrySettings::FilterNone);
 
-	void read(gpx::WPT *wpt);
+	void read(const GPXStore &store, size_t i, enum TelemetrySettings::Filter filter=TelemetrySettings::FilterNone);
 
 	void enableCompute(void) {
 		enable_ = true;
@@ -68,6 +68,15 @@ public:
 		return next_pt_.time;
 	}
 
+	const int64_t& timeMs(Position p = PositionCurrent) const {
+		if (p == PositionCurrent)
+			return cur_pt_.time_ms;
+		if (p == PositionPrevious)
+			return prev_pt_.time_ms;
+
+		return next_pt_.time_ms;
+	}
+
 	const struct point& position(Position p = PositionCurrent) const {
 		if (p == PositionCurrent)
 			return cur_pt_;
@@ -138,19 +147,25 @@ public:
 		return heartrate_;
 	}
 
-	static void convert(struct point *pt, gpx::WPT *wpt);
+	const int& power(void) const {
+		return power_;
+	}
 
 protected:
 	bool enable_;
 	bool has_value_;
 
+	// Store & index of next point
+	const GPXStore *store_;
+	size_t index_;
+
 	int nbr_points_;
 	struct point cur_pt_;
 	struct point prev_pt_;
 	struct point next_pt_;
 
 	int nbr_predictions_;
-	KalmanFilter filter_;
+	KalmanVelocity2D filter_;
 
 	int line_;
 	bool valid_;
@@ -164,9 +179,11 @@ protected:
 	double temperature_;
 	int heartrate_;
 	int cadence_;
+	int power_;
 };
 
 
+// Cursor on a shared track store (cheap to copy, one per worker)
 class GPX {
 public:
 	enum Data {
@@ -206,22 +223,29 @@ public:
 	enum Data retrieveData(GPXData &data);
 	enum Data retrieveLast(GPXData &data);
 
-protected:
-	bool parse(void);
+	enum Data seek(GPXData &data, int64_t timecode_ms);
 
-	enum Data retrieveFirst_i(GPXData &data);
+	const GPXStore& store(void) const {
+		return *store_;
+	}
 
-private:
-	GPX(std::ifstream &stream, gpx::GPX *root, enum TelemetrySettings::Filter filter);
+	std::shared_ptr<const GPXStore> sharedStore(void) const {
+		return store_;
+	}
 
-    std::ifstream &stream_;
+	void range(size_t *first, size_t *last);
 
-	gpx::GPX *root_;
+protected:
+	enum Data retrieveFirst_i(GPXData &data);
+
+private:
+	GPX(std::shared_ptr<const GPXStore> store, enum TelemetrySettings::Filter filter);
 
-	gpx::TRK *trk_;
+	// Shared & immutable track points
+	std::shared_ptr<const GPXStore> store_;
 
-	std::list<gpx::WPT*>::iterator iter_pts_;
-	std::list<gpx::TRKSeg*>::iterator iter_seg_;
+	// Next read point in the store
+	size_t pos_;
 
 	int offset_;
 
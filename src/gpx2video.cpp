@@ -16,6 +16,7 @@
 
 extern "C" {
 #include <event2/event.h>
+#include <libavutil/time.h>
 }
 
 #include "log.h"
@@ -57,6 +58,10 @@ GPX2Video::GPX2Video(struct event_base *evbase)
 GPX2Video::~GPX2Video() {
 	log_call();
 
+	// Action event
+	event_del(ev_action_);
+	event_free(ev_action_);
+
 	// Signal event
 	event_del(ev_signal_);
 	event_free(ev_signal_);
@@ -244,30 +249,57 @@ sighandler_error:
 }
 
 
-void GPX2Video::pipehandler(int sfd, short kind, void *data) {
-	int32_t info;
+void GPX2Video::perform(Task *task, enum Task::Action action) {
+	struct timeval now = { 0, 0 };
+
+	log_call();
+
+	actions_.push_back(std::make_pair(task, action));
+
+	// Wake up the loop (a timer doesn't require any syscall)
+	if (!event_pending(ev_action_, EV_TIMEOUT, NULL))
+		event_add(ev_action_, &now);
+}
+
+
+void GPX2Video::actionhandler(int sfd, short kind, void *data) {
+	int n;
+
+	int64_t deadline;
 
-	size_t bytes;
+	struct timeval now = { 0, 0 };
 
 	GPX2Video *app = (GPX2Video *) data;
 
+	GPX2Video::Task *task;
+	enum GPX2Video::Task::Action action;
+
 	log_call();
 
 	(void) sfd;
 	(void) kind;
 
-	bytes = read(app->pipe_in_, &info, sizeof(info));
+	deadline = av_gettime_relative() + GPX2VIDEO_TICK_DURATION;
+
+	// Drain ready queue (actions of all running tasks), then yield to the loop so that signals are handled
+	for (n=0; (n < GPX2VIDEO_TICK_ACTIONS) && !app->actions_.empty(); n++) {
+		task = app->actions_.front().first;
+		action = app->actions_.front().second;
+		app->actions_.pop_front();
 
-	(void) bytes;
+		app->run(task, action);
 
-	app->run((enum GPX2Video::Task::Action) info);
+		if (av_gettime_relative() > deadline)
+			break;
+	}
+
+	// Next tick
+	if (!app->actions_.empty() && !event_pending(app->ev_action_, EV_TIMEOUT, NULL))
+		event_add(app->ev_action_, &now);
 }
 
 
 void GPX2Video::init(void) {
-	int error;
-
-	int fds[2];
 	int sfd = -1;
 
 	sigset_t mask;
@@ -298,18 +330,8 @@ void GPX2Video::init(void) {
 	ev_signal_ = event_new(evbase_, sfd, EV_READ | EV_PERSIST, sighandler, this);
 	event_add(ev_signal_, NULL);
 
-	// Create pipe to schedule tasks
-	error = pipe(fds);
-
-	if (error == -1) {
-		log_error("Unable to create pipe");
-		return;
-	}
-
-	pipe_in_ = fds[0];
-	pipe_out_ = fds[1];
-	ev_pipe_ = event_new(evbase_, pipe_in_, EV_READ | EV_PERSIST, pipehandler, this);
-	event_add(ev_pipe_, NULL);
+	// Ready queue to schedule tasks
+	ev_action_ = evtimer_new(evbase_, actionhandler, this);
 }
 
 
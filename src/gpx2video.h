@@ -13,6 +13,12 @@
 #include "mapsettings.h"
 #include "extractorsettings.h"
 #include "telemetrysettings.h"
+#include "renderersettings.h"
+
+
+// Run loop tick, max actions and duration (in us) before yielding
+#define GPX2VIDEO_TICK_ACTIONS 64
+#define GPX2VIDEO_TICK_DURATION 20000
 
 
 class Map;
@@ -34,7 +40,13 @@ public:
 			std::string gpx_from="",
 			std::string gpx_to="",
 			ExtractorSettings::Format extract_format=ExtractorSettings::FormatDump,
-			TelemetrySettings::Filter telemetry_filter=TelemetrySettings::FilterNone)
+			TelemetrySettings::Filter telemetry_filter=TelemetrySettings::FilterNone,
+			int timelapse=1,
+			int checkpoint=0,
+			int trim_ms=0,
+			std::list<RendererSettings> renditions=std::list<RendererSettings>(),
+			int live_ms=0,
+			bool overlay_cache=false)
 			: gpx_file_(gpx_file)
 			, media_file_(media_file)
 			, layout_file_(layout_file)
@@ -47,7 +59,13 @@ public:
 			, gpx_from_(gpx_from)
 			, gpx_to_(gpx_to)
 	   		, extract_format_(extract_format) 
-			, telemetry_filter_(telemetry_filter) {
+			, telemetry_filter_(telemetry_filter)
+			, timelapse_(timelapse)
+			, checkpoint_(checkpoint)
+			, trim_ms_(trim_ms)
+			, renditions_(renditions)
+			, live_ms_(live_ms)
+			, overlay_cache_(overlay_cache) {
 		}
 
 		const std::string& gpxfile(void) const {
@@ -102,6 +120,30 @@ public:
 			return gpx_to_;
 		}
 
+		const int& timelapse(void) const {
+			return timelapse_;
+		}
+
+		const int& checkpoint(void) const {
+			return checkpoint_;
+		}
+
+		const int& trim(void) const {
+			return trim_ms_;
+		}
+
+		const std::list<RendererSettings>& renditions(void) const {
+			return renditions_;
+		}
+
+		const int& live(void) const {
+			return live_ms_;
+		}
+
+		const bool& overlayCache(void) const {
+			return overlay_cache_;
+		}
+
 	private:
 		std::string gpx_file_;
 		std::string media_file_;
@@ -120,6 +162,16 @@ public:
 
 		ExtractorSettings::Format extract_format_;
 		TelemetrySettings::Filter telemetry_filter_;
+
+		int timelapse_;
+		int checkpoint_;
+		int trim_ms_;
+
+		std::list<RendererSettings> renditions_;
+
+		int live_ms_;
+
+		bool overlay_cache_;
 	};
 
 	class Task {
@@ -130,10 +182,17 @@ public:
 			ActionStop
 		};
 
+		enum State {
+			StateWait,
+			StateRunning,
+			StateDone
+		};
+
 		typedef void (*callback_t)(void *object);
 
 		Task(GPX2Video &app)
-			: app_(app) {
+			: app_(app)
+			, state_(StateWait) {
 		}
 
 		virtual ~Task() {
@@ -150,15 +209,42 @@ public:
 		};
 
 		void schedule(void) {
-			app_.perform(ActionPerform);
+			app_.perform(this, ActionPerform);
 		}
 
 		void complete(void) {
-			app_.perform(ActionStop);
+			app_.perform(this, ActionStop);
+		}
+
+		const State& state(void) const {
+			return state_;
+		}
+
+		void setState(const State &state) {
+			state_ = state;
+		}
+
+		// Task can't start before its prerequisites are done
+		void addDependency(Task *task) {
+			if (task != NULL)
+				depends_.push_back(task);
+		}
+
+		bool isReady(void) const {
+			for (Task *task : depends_) {
+				if (task->state() != StateDone)
+					return false;
+			}
+
+			return true;
 		}
 
 	private:
 		GPX2Video &app_;
+
+		State state_;
+
+		std::list<Task *> depends_;
 	};
 
 	enum Command {
@@ -217,48 +303,61 @@ public:
 		time_ = time;
 	}
 
-	void perform(enum Task::Action action=Task::ActionPerform) {
-		int32_t info;
-
-		log_call();
-
-		info = (int32_t) action;
-
-		write(pipe_out_, &info, sizeof(info));
-	}
-
-	void run(enum Task::Action action) {
-		Task *task;
+	void perform(Task *task, enum Task::Action action=Task::ActionPerform);
 
-		if (tasks_.empty())
-			goto done;
+	void run(Task *task, enum Task::Action action) {
+		// Task already stopped (abort)
+		if (task->state() != Task::StateRunning)
+			return;
 
 		switch (action) {
 		case Task::ActionStart:
-			task = tasks_.front();
 			if (task->start() == true)
-				perform(Task::ActionPerform);
+				perform(task, Task::ActionPerform);
 			else
-				perform(Task::ActionStop);
+				perform(task, Task::ActionStop);
 			break;
 
 		case Task::ActionPerform:
-			task = tasks_.front();
 			task->run();
 			break;
 
 		case Task::ActionStop:
-			task = tasks_.front();
 			task->stop();
+			task->setState(Task::StateDone);
 
-			tasks_.pop_front();
+			tasks_.remove(task);
 
-			perform(Task::ActionStart);
+			next();
 			break;
 
 		default:
 			break;
 		}
+	}
+
+	void next(void) {
+		int running = 0;
+
+		if (tasks_.empty())
+			goto done;
+
+		// Start each task whose prerequisites are done
+		for (Task *task : tasks_) {
+			if ((task->state() == Task::StateWait) && task->isReady()) {
+				task->setState(Task::StateRunning);
+
+				perform(task, Task::ActionStart);
+			}
+
+			if (task->state() == Task::StateRunning)
+				running++;
+		}
+
+		if (running == 0) {
+			log_error("Tasks dependency loop, none task can start");
+			goto done;
+		}
 
 		return;
 
@@ -269,18 +368,23 @@ public:
 	void exec(void) {
 		log_call();
 
-		perform(Task::ActionStart);
+		next();
 		loop();
 	}
 
 	void abort(void) {
 		log_call();
 
-		// Before loop exit, stop the current task
-		if (!tasks_.empty()) {
-			Task *task = tasks_.front();
+		// Drop pending actions
+		actions_.clear();
+
+		// Before loop exit, stop the running tasks
+		for (Task *task : tasks_) {
+			if (task->state() != Task::StateRunning)
+				continue;
 
 			task->stop();
+			task->setState(Task::StateDone);
 		}
 
 		loopexit();
@@ -288,7 +392,7 @@ public:
 
 protected:
 	static void sighandler(int sfd, short kind, void *data);
-	static void pipehandler(int sfd, short kind, void *data);
+	static void actionhandler(int sfd, short kind, void *data);
 
 	void init(void);
 
@@ -296,10 +400,7 @@ protected:
 	void loopexit(void);
 
 private:
-	int pipe_in_;
-	int pipe_out_;
-
-	struct event *ev_pipe_;
+	struct event *ev_action_;
 	struct event *ev_signal_;
 	struct event_base *evbase_;
 
@@ -311,6 +412,7 @@ private:
 	MediaContainer *container_;
 
 	std::list<Task *> tasks_;
+	std::list<std::pair<Task *, enum Task::Action> > actions_;
 
 	time_t time_;
 };
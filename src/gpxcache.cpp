@@ -0,0 +1,270 @@
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "log.h"
+#include "utils.h"
+#include "distance.h"
+#include "gpxcache.h"
+
+
+// Sections are 8 bytes aligned, so that mapped columns can be read in place
+#define GPXCACHE_ALIGN(n) (((n) + 7) & ~((size_t) 7))
+
+
+template <typename T>
+static void put(std::vector<uint8_t> &data, const T *values, size_t n) {
+	const uint8_t *p = (const uint8_t *) values;
+
+	data.insert(data.end(), p, p + n * sizeof(T));
+	data.resize(GPXCACHE_ALIGN(data.size()), 0);
+}
+
+
+template <typename T>
+static bool get(const uint8_t *data, size_t size, size_t &pos, size_t n, std::vector<T> &values) {
+	const T *p = (const T *) (data + pos);
+
+	if ((n > size / sizeof(T)) || (pos + n * sizeof(T) > size))
+		return false;
+
+	values.assign(p, p + n);
+	pos = GPXCACHE_ALIGN(pos + n * sizeof(T));
+
+	return true;
+}
+
+
+bool GPXCache::key(const std::string &filename, uint64_t *key) {
+	char *realname;
+
+	struct stat st;
+
+	if ((::stat(filename.c_str(), &st) != 0) || (::access(filename.c_str(), R_OK) != 0))
+		return false;
+
+	// Source path, size & mtime
+	realname = ::realpath(filename.c_str(), NULL);
+	*key = hashData((realname != NULL) ? std::string(realname) : filename);
+	free(realname);
+
+	const int64_t values[] = {
+		(int64_t) st.st_size, (int64_t) st.st_mtim.tv_sec, (int64_t) st.st_mtim.tv_nsec,
+		(int64_t) Distance::accuracy(), GPXCACHE_VERSION
+	};
+
+	*key = hashData(values, sizeof(values), *key);
+
+	// Whole content (a file edited in the middle within the mtime resolution),
+	// one sequential read is still far cheaper than parsing the file again
+	*key = hashFile(filename, *key);
+
+	return true;
+}
+
+
+std::string GPXCache::path(uint64_t key, bool create) {
+	std::ostringstream stream;
+
+	std::string path = std::getenv("HOME") + std::string("/.gpx2video/cache/telemetry");
+
+	if (create)
+		::mkpath(path, 0700);
+
+	stream << path << "/" << std::hex << std::setfill('0') << std::setw(16) << key << ".gpx2v";
+
+	return stream.str();
+}
+
+
+bool GPXCache::load(const std::string &filename, GPXStore *store) {
+	int fd = -1;
+
+	size_t i, n, pos, size = 0;
+
+	uint64_t k;
+
+	struct stat st;
+
+	Header header;
+
+	const uint8_t *data = (const uint8_t *) MAP_FAILED;
+	const char *s, *end;
+
+	std::vector<uint64_t> segments;
+	std::vector<char> info;
+
+	bool result = false;
+
+	log_call();
+
+	if (!key(filename, &k))
+		goto done;
+
+	if ((fd = ::open(path(k).c_str(), O_RDONLY)) < 0)
+		goto done;
+
+	if ((fstat(fd, &st) != 0) || ((size_t) st.st_size < sizeof(header)))
+		goto done;
+
+	size = st.st_size;
+
+	data = (const uint8_t *) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (data == MAP_FAILED)
+		goto done;
+
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.magic, GPXCACHE_MAGIC, 4) || (header.version != GPXCACHE_VERSION)
+			|| (header.accuracy != (uint32_t) Distance::accuracy()) || (header.key != k))
+		goto done;
+
+	n = header.nbr_points;
+	pos = sizeof(header);
+
+	store->clear();
+
+	// Columns
+	if (!get(data, size, pos, header.nbr_segments, segments)
+			|| !get(data, size, pos, n, store->line_)
+			|| !get(data, size, pos, n, store->time_)
+			|| !get(data, size, pos, n, store->lat_)
+			|| !get(data, size, pos, n, store->lon_)
+			|| !get(data, size, pos, n, store->ele_)
+			|| !get(data, size, pos, n, store->temperature_)
+			|| !get(data, size, pos, n, store->cadence_)
+			|| !get(data, size, pos, n, store->heartrate_)
+			|| !get(data, size, pos, n, store->power_)
+			|| !get(data, size, pos, n, store->distance_)
+			|| !get(data, size, pos, n, store->speed_)
+			|| !get(data, size, pos, n, store->grade_)
+			|| !get(data, size, pos, n, store->moving_)
+			|| !get(data, size, pos, header.info_size, info))
+		goto corrupted;
+
+	// Segment starts: 0 first, then strictly ascending point indexes
+	if ((n > 0) && (segments.empty() || (segments[0] != 0)))
+		goto corrupted;
+
+	for (i=0; i<segments.size(); i++) {
+		if ((segments[i] >= n) || ((i > 0) && (segments[i] <= segments[i-1])))
+			goto corrupted;
+
+		store->segments_.push_back(segments[i]);
+	}
+
+	// Track info: "name\0value\0"...
+	s = info.data();
+	end = info.data() + info.size();
+
+	while (s < end) {
+		const char *value = s + strnlen(s, end - s) + 1;
+
+		if (value >= end)
+			break;
+
+		store->info_[s] = std::string(value, strnlen(value, end - value));
+
+		s = value + strnlen(value, end - value) + 1;
+	}
+
+	log_info("GPX track: %lu points in %lu segments (from cache)",
+		(unsigned long) store->size(), (unsigned long) store->segments().size());
+
+	result = true;
+
+	goto done;
+
+corrupted:
+	log_warn("Telemetry cache of '%s' is corrupted", filename.c_str());
+	store->clear();
+
+done:
+	if (data != MAP_FAILED)
+		munmap((void *) data, size);
+	if (fd >= 0)
+		::close(fd);
+
+	return result;
+}
+
+
+bool GPXCache::save(const std::string &filename, const GPXStore *store) {
+	uint64_t k;
+
+	Header header;
+
+	std::string name, tmpfile;
+
+	std::vector<uint8_t> data;
+	std::vector<uint64_t> segments(store->segments_.begin(), store->segments_.end());
+	std::vector<char> info;
+
+	log_call();
+
+	if (!key(filename, &k))
+		return false;
+
+	name = path(k, true);
+	tmpfile = name + ".tmp";
+
+	for (std::map<std::string, std::string>::const_iterator iter = store->info_.begin(); iter != store->info_.end(); ++iter) {
+		info.insert(info.end(), iter->first.c_str(), iter->first.c_str() + iter->first.size() + 1);
+		info.insert(info.end(), iter->second.c_str(), iter->second.c_str() + iter->second.size() + 1);
+	}
+
+	// Header
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, GPXCACHE_MAGIC, 4);
+	header.version = GPXCACHE_VERSION;
+	header.accuracy = Distance::accuracy();
+	header.key = k;
+	header.nbr_points = store->size();
+	header.nbr_segments = segments.size();
+	header.info_size = info.size();
+
+	put(data, &header, 1);
+
+	// Columns
+	put(data, segments.data(), segments.size());
+	put(data, store->line_.data(), store->line_.size());
+	put(data, store->time_.data(), store->time_.size());
+	put(data, store->lat_.data(), store->lat_.size());
+	put(data, store->lon_.data(), store->lon_.size());
+	put(data, store->ele_.data(), store->ele_.size());
+	put(data, store->temperature_.data(), store->temperature_.size());
+	put(data, store->cadence_.data(), store->cadence_.size());
+	put(data, store->heartrate_.data(), store->heartrate_.size());
+	put(data, store->power_.data(), store->power_.size());
+	put(data, store->distance_.data(), store->distance_.size());
+	put(data, store->speed_.data(), store->speed_.size());
+	put(data, store->grade_.data(), store->grade_.size());
+	put(data, store->moving_.data(), store->moving_.size());
+	put(data, info.data(), info.size());
+
+	std::ofstream stream(tmpfile, std::ios::binary);
+
+	if (!stream.is_open())
+		return false;
+
+	stream.write((const char *) data.data(), data.size());
+	stream.close();
+
+	// Atomic update (a crashed run doesn't leave half an entry)
+	if (!stream || (::rename(tmpfile.c_str(), name.c_str()) != 0)) {
+		::remove(tmpfile.c_str());
+		return false;
+	}
+
+	return true;
+}
+
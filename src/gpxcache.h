@@ -0,0 +1,43 @@
+#ifndef __GPX2VIDEO__GPXCACHE_H__
+#define __GPX2VIDEO__GPXCACHE_H__
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "gpxstore.h"
+
+
+// Telemetry file format
+#define GPXCACHE_MAGIC "G2VT"
+#define GPXCACHE_VERSION 2
+
+
+/**
+ * On-disk cache of parsed track stores (.gpx2v files).
+ * An entry is keyed by the source path, size, mtime & a hash of its whole
+ * content, and holds every column (derived ones included) ready to be mapped.
+ */
+class GPXCache {
+public:
+	static bool load(const std::string &filename, GPXStore *store);
+	static bool save(const std::string &filename, const GPXStore *store);
+
+private:
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint32_t accuracy;
+		uint32_t reserved;
+		uint64_t key;
+		uint64_t nbr_points;
+		uint64_t nbr_segments;
+		uint64_t info_size;
+	};
+
+	static bool key(const std::string &filename, uint64_t *key);
+	static std::string path(uint64_t key, bool create=false);
+};
+
+#endif
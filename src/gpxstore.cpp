@@ -0,0 +1,1040 @@
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <functional>
+
+#include <ctype.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "utmconvert/utmconvert.h"
+
+#include "log.h"
+#include "datetime.h"
+#include "distance.h"
+#include "kalmanfilter.h"
+#include "gpxcache.h"
+#include "fitreader.h"
+#include "gpxstore.h"
+
+
+std::mutex GPXStore::registry_mutex_;
+std::map<std::string, GPXStore::Entry> GPXStore::registry_;
+
+
+// Track points between two <trkpt> tags, parsed into their own columns
+struct GPXChunk {
+	const char *begin, *end;
+
+	size_t lines;	// newlines in the chunk
+	size_t offset;	// store index of its first point
+	int line;		// line number of its first byte
+
+	std::unique_ptr<GPXStore> store;
+};
+
+
+// Next <trkpt> start tag in [s, end), NULL if none
+static const char * findPoint(const char *s, const char *end) {
+	const size_t length = sizeof("<trkpt") - 1;
+
+	while ((s = (const char *) memmem(s, end - s, "<trkpt", length)) != NULL) {
+		if ((s + length < end) && (isspace(s[length]) || (s[length] == '>') || (s[length] == '/')))
+			return s;
+
+		s += length;
+	}
+
+	return NULL;
+}
+
+
+// Last tag in [begin, end), searched backward from the end, NULL if none
+static const char * findLast(const char *begin, const char *end, const char *tag) {
+	const size_t length = strlen(tag);
+
+	const char *s = end;
+
+	while ((s = (const char *) memrchr(begin, '<', s - begin)) != NULL) {
+		if (((size_t) (end - s) >= length) && (memcmp(s, tag, length) == 0))
+			return s;
+	}
+
+	return NULL;
+}
+
+
+// Chunks are parsed without the XML declaration, so as UTF-8
+static bool isUTF8(const char *data, size_t size) {
+	const char *end, *s;
+
+	std::string declaration;
+
+	if ((size < 5) || (memcmp(data, "<?xml", 5) != 0))
+		return true;
+
+	if ((end = (const char *) memmem(data, size, "?>", 2)) == NULL)
+		return true;
+
+	declaration.assign(data, end - data);
+
+	if ((s = strcasestr(declaration.c_str(), "encoding")) == NULL)
+		return true;
+
+	return (strcasestr(s, "utf-8") != NULL) || (strcasestr(s, "ascii") != NULL);
+}
+
+
+template <typename T>
+static void copy(std::vector<T> &to, size_t offset, const std::vector<T> &from) {
+	std::copy(from.begin(), from.end(), to.begin() + offset);
+}
+
+
+GPXStore::GPXStore()
+	: parser_(NULL)
+	, depth_(0)
+	, trk_depth_(0)
+	, in_trk_(false)
+	, in_pt_(false)
+	, in_extensions_(false)
+	, done_(false)
+	, split_(true)
+	, projected_(false)
+	, smoothed_(false) {
+}
+
+
+GPXStore::~GPXStore() {
+	if (parser_ != NULL)
+		XML_ParserFree(parser_);
+}
+
+
+GPXStore * GPXStore::open(const std::string &filename) {
+	bool ok = true;
+
+	GPXStore *store = NULL;
+
+	std::vector<char> buffer(GPXSTORE_READ_SIZE);
+
+	std::ifstream stream(filename, std::ios::binary);
+
+	log_call();
+
+	if (!stream.is_open()) {
+		log_error("Open '%s' GPX file failure, please check that file is readable", filename.c_str());
+		goto failure;
+	}
+
+	// Binary FIT activity: decoded without any XML parsing
+	if (FITReader::probe(filename)) {
+		store = new GPXStore();
+
+		if (!FITReader::read(filename, store))
+			goto failure;
+
+		goto done;
+	}
+
+	// Large GPX file: track points are parsed by chunks on every core
+	if ((store = GPXStore::parseChunks(filename)) != NULL)
+		goto done;
+
+	store = new GPXStore();
+
+	store->parser_ = XML_ParserCreate(NULL);
+
+	XML_SetUserData(store->parser_, store);
+	XML_SetElementHandler(store->parser_, startElementHandler, endElementHandler);
+	XML_SetCharacterDataHandler(store->parser_, characterDataHandler);
+
+	// Stream the file by chunks, points go straight to the columns
+	while (ok && stream.good() && !store->done_) {
+		stream.read(buffer.data(), buffer.size());
+
+		ok = (XML_Parse(store->parser_, buffer.data(), (int) stream.gcount(), stream.eof()) != XML_STATUS_ERROR);
+	}
+
+	// Parser is stopped once the first track is read
+	if (!ok && (XML_GetErrorCode(store->parser_) != XML_ERROR_ABORTED)) {
+		log_error("Parsing of '%s' failed due to %s on line %lu and column %lu", 
+			filename.c_str(), XML_ErrorString(XML_GetErrorCode(store->parser_)),
+			(unsigned long) XML_GetCurrentLineNumber(store->parser_),
+			(unsigned long) XML_GetCurrentColumnNumber(store->parser_));
+		goto failure;
+	}
+
+	XML_ParserFree(store->parser_);
+	store->parser_ = NULL;
+
+done:
+	store->index();
+	store->compute();
+
+	log_info("Track: %lu points in %lu segments",
+		(unsigned long) store->size(), (unsigned long) store->segments().size());
+
+	return store;
+
+failure:
+	if (store != NULL)
+		delete store;
+
+	return NULL;
+}
+
+
+GPXStore * GPXStore::parseChunks(const std::string &filename) {
+	int fd = -1;
+	int line;
+
+	bool ok = false;
+
+	size_t i, n, size = 0;
+
+	struct stat st;
+
+	const char *data = (const char *) MAP_FAILED;
+	const char *s, *e, *body, *tail;
+
+	GPXStore *store = NULL;
+
+	std::atomic<size_t> next(0);
+	std::atomic<bool> failed(false);
+
+	std::vector<std::thread> threads;
+
+	std::vector<GPXChunk> chunks;
+
+	// A chunk is parsed as a lone segment: <trk><trkseg>...</trkseg></trk>
+	auto parse = [&]() {
+		size_t j;
+
+		bool result;
+
+		while (!failed && ((j = next++) < chunks.size())) {
+			GPXChunk &chunk = chunks[j];
+			GPXStore *part = new GPXStore();
+
+			chunk.store.reset(part);
+			chunk.lines = std::count(chunk.begin, chunk.end, '\n');
+
+			part->parser_ = XML_ParserCreate("UTF-8");
+
+			XML_SetUserData(part->parser_, part);
+			XML_SetElementHandler(part->parser_, startElementHandler, endElementHandler);
+			XML_SetCharacterDataHandler(part->parser_, characterDataHandler);
+
+			result = (XML_Parse(part->parser_, "<trk><trkseg>", 13, XML_FALSE) != XML_STATUS_ERROR);
+
+			// Segment start is known by the previous chunk
+			part->split_ = false;
+
+			result = result
+				&& (XML_Parse(part->parser_, chunk.begin, (int) (chunk.end - chunk.begin), XML_FALSE) != XML_STATUS_ERROR)
+				&& !part->done_;
+
+			// Only the wrapper may end the track
+			if (result && (XML_Parse(part->parser_, "</trkseg></trk>", 15, XML_TRUE) == XML_STATUS_ERROR))
+				result = (XML_GetErrorCode(part->parser_) == XML_ERROR_ABORTED);
+
+			result = result && part->done_;
+
+			XML_ParserFree(part->parser_);
+			part->parser_ = NULL;
+
+			if (!result)
+				failed = true;
+		}
+	};
+
+	// Chunk columns are copied at their final place
+	auto stitch = [&]() {
+		size_t j, m;
+
+		while ((j = next++) < chunks.size()) {
+			GPXChunk &chunk = chunks[j];
+			GPXStore *part = chunk.store.get();
+
+			for (m=0; m<part->size(); m++)
+				store->line_[chunk.offset + m] = chunk.line + part->line_[m] - 1;
+
+			copy(store->time_, chunk.offset, part->time_);
+			copy(store->lat_, chunk.offset, part->lat_);
+			copy(store->lon_, chunk.offset, part->lon_);
+			copy(store->ele_, chunk.offset, part->ele_);
+			copy(store->temperature_, chunk.offset, part->temperature_);
+			copy(store->cadence_, chunk.offset, part->cadence_);
+			copy(store->heartrate_, chunk.offset, part->heartrate_);
+			copy(store->power_, chunk.offset, part->power_);
+
+			chunk.store.reset();
+		}
+	};
+
+	log_call();
+
+	if (std::thread::hardware_concurrency() < 2)
+		goto done;
+
+	if ((fd = ::open(filename.c_str(), O_RDONLY)) < 0)
+		goto done;
+
+	if ((fstat(fd, &st) != 0) || (st.st_size < GPXSTORE_PARALLEL_SIZE))
+		goto done;
+
+	size = st.st_size;
+
+	// Chunks are parsed at the same time, pages are read by every worker
+	data = (const char *) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (data == MAP_FAILED)
+		goto done;
+
+	// Track points lie between the first <trkpt> and the last </trkseg>
+	if (!isUTF8(data, size))
+		goto done;
+
+	if (((body = findPoint(data, data + size)) == NULL) || ((tail = findLast(body, data + size, "</trkseg>")) == NULL))
+		goto done;
+
+	if ((body - data > GPXSTORE_PARSE_CHUNK_SIZE) || (data + size - tail > GPXSTORE_PARSE_CHUNK_SIZE))
+		goto done;
+
+	store = new GPXStore();
+
+	store->parser_ = XML_ParserCreate(NULL);
+
+	XML_SetUserData(store->parser_, store);
+	XML_SetElementHandler(store->parser_, startElementHandler, endElementHandler);
+	XML_SetCharacterDataHandler(store->parser_, characterDataHandler);
+
+	// Header parsing has to stop in a segment of the first track
+	if (XML_Parse(store->parser_, data, (int) (body - data), XML_FALSE) == XML_STATUS_ERROR)
+		goto done;
+
+	if (!store->in_trk_ || store->in_pt_ || (store->depth_ != store->trk_depth_ + 1))
+		goto done;
+
+	// Split the track points at <trkpt> tags
+	for (s=body; s<tail; s=e) {
+		e = (tail - s > GPXSTORE_PARSE_CHUNK_SIZE) ? findPoint(s + GPXSTORE_PARSE_CHUNK_SIZE, tail) : NULL;
+
+		chunks.emplace_back();
+		chunks.back().begin = s;
+		chunks.back().end = (e != NULL) ? e : tail;
+
+		if (e == NULL)
+			break;
+	}
+
+	n = std::min<size_t>(chunks.size(), std::thread::hardware_concurrency());
+
+	for (i=1; i<n; i++)
+		threads.push_back(std::thread(parse));
+
+	parse();
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	// Comment, CDATA or second track in the points, the caller parses the whole file
+	if (failed) {
+		log_debug("Chunked parsing of '%s' failed, fall back to a single pass", filename.c_str());
+		goto done;
+	}
+
+	// Chunk offsets & segments, in file order
+	line = 1 + std::count(data, body, '\n');
+
+	n = 0;
+
+	for (GPXChunk &chunk : chunks) {
+		GPXStore *part = chunk.store.get();
+
+		chunk.offset = n;
+		chunk.line = line;
+
+		if (!part->empty()) {
+			if (store->split_ && (part->segments_.empty() || (part->segments_[0] != 0)))
+				store->segments_.push_back(chunk.offset);
+
+			for (size_t segment : part->segments_)
+				store->segments_.push_back(chunk.offset + segment);
+
+			store->split_ = part->split_;
+		}
+		else
+			store->split_ = store->split_ || part->split_;
+
+		n += part->size();
+		line += chunk.lines;
+	}
+
+	store->line_.resize(n);
+	store->time_.resize(n);
+	store->lat_.resize(n);
+	store->lon_.resize(n);
+	store->ele_.resize(n);
+	store->temperature_.resize(n);
+	store->cadence_.resize(n);
+	store->heartrate_.resize(n);
+	store->power_.resize(n);
+
+	next = 0;
+	threads.clear();
+
+	for (i=1; i<std::min<size_t>(chunks.size(), std::thread::hardware_concurrency()); i++)
+		threads.push_back(std::thread(stitch));
+
+	stitch();
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	// Tail: end of the first track
+	if ((XML_Parse(store->parser_, tail, (int) (data + size - tail), XML_TRUE) == XML_STATUS_ERROR)
+			&& (XML_GetErrorCode(store->parser_) != XML_ERROR_ABORTED))
+		goto done;
+
+	XML_ParserFree(store->parser_);
+	store->parser_ = NULL;
+
+	log_debug("Parsed '%s' in %lu chunks", filename.c_str(), (unsigned long) chunks.size());
+
+	ok = true;
+
+done:
+	if (data != MAP_FAILED)
+		munmap((void *) data, size);
+	if (fd >= 0)
+		::close(fd);
+
+	if (!ok && (store != NULL)) {
+		delete store;
+		store = NULL;
+	}
+
+	return store;
+}
+
+
+std::shared_ptr<const GPXStore> GPXStore::get(const std::string &filename) {
+	struct stat st;
+
+	GPXStore *store;
+
+	std::lock_guard<std::mutex> lock(registry_mutex_);
+
+	log_call();
+
+	if (::stat(filename.c_str(), &st) != 0)
+		memset(&st, 0, sizeof(st));
+
+	// Already parsed & file unchanged
+	std::map<std::string, Entry>::iterator iter = registry_.find(filename);
+
+	if ((iter != registry_.end())
+			&& (iter->second.mtime == st.st_mtime) && (iter->second.size == st.st_size))
+		return iter->second.store;
+
+	// Columns may be cached by a previous run
+	store = new GPXStore();
+
+	if (!GPXCache::load(filename, store)) {
+		delete store;
+
+		if ((store = GPXStore::open(filename)) == NULL)
+			return NULL;
+
+		if (!GPXCache::save(filename, store))
+			log_warn("Can't write telemetry cache of '%s'", filename.c_str());
+	}
+
+	Entry &entry = registry_[filename];
+
+	entry.mtime = st.st_mtime;
+	entry.size = st.st_size;
+	entry.store = std::shared_ptr<const GPXStore>(store);
+
+	return entry.store;
+}
+
+
+void GPXStore::clear(void) {
+	split_ = true;
+
+	segments_.clear();
+
+	line_.clear();
+	time_.clear();
+	lat_.clear();
+	lon_.clear();
+	ele_.clear();
+	x_.clear();
+	y_.clear();
+	projected_ = false;
+	smooth_lat_.clear();
+	smooth_lon_.clear();
+	smooth_ele_.clear();
+	smoothed_ = false;
+	temperature_.clear();
+	cadence_.clear();
+	heartrate_.clear();
+	power_.clear();
+}
+
+
+void GPXStore::reserve(size_t n) {
+	line_.reserve(n);
+	time_.reserve(n);
+	lat_.reserve(n);
+	lon_.reserve(n);
+	ele_.reserve(n);
+	temperature_.reserve(n);
+	cadence_.reserve(n);
+	heartrate_.reserve(n);
+	power_.reserve(n);
+}
+
+
+void GPXStore::split(void) {
+	split_ = true;
+}
+
+
+void GPXStore::append(int line, int64_t time_ms, double lat, double lon, double ele,
+	double temperature, int cadence, int heartrate, int power) {
+	if (split_) {
+		segments_.push_back(time_.size());
+		split_ = false;
+	}
+
+	line_.push_back(line);
+	time_.push_back(time_ms);
+	lat_.push_back(lat);
+	lon_.push_back(lon);
+	ele_.push_back(ele);
+	temperature_.push_back(temperature);
+	cadence_.push_back(cadence);
+	heartrate_.push_back(heartrate);
+	power_.push_back(power);
+}
+
+
+template <typename T>
+static void permute(std::vector<T> &values, const std::vector<size_t> &order) {
+	std::vector<T> result(values.size());
+
+	for (size_t i=0; i<order.size(); i++)
+		result[i] = values[order[i]];
+
+	values.swap(result);
+}
+
+
+void GPXStore::index(void) {
+	size_t i;
+
+	std::vector<size_t> order;
+
+	log_call();
+
+	// Time column has to be sorted for seeking, it usually already is
+	if (std::is_sorted(time_.begin(), time_.end()))
+		return;
+
+	log_warn("GPX track points aren't in time order, sorting them");
+
+	order.resize(size());
+
+	for (i=0; i<order.size(); i++)
+		order[i] = i;
+
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return time_[a] < time_[b];
+	});
+
+	permute(line_, order);
+	permute(time_, order);
+	permute(lat_, order);
+	permute(lon_, order);
+	permute(ele_, order);
+	permute(temperature_, order);
+	permute(cadence_, order);
+	permute(heartrate_, order);
+	permute(power_, order);
+
+	// Segments can't be kept once reordered
+	segments_.assign(1, 0);
+}
+
+
+void GPXStore::project(void) const {
+	size_t i, n;
+
+	struct Utm_val utm;
+
+	if (projected_)
+		return;
+
+	std::lock_guard<std::mutex> lock(utm_mutex_);
+
+	// Another reader projected the track meanwhile
+	if (projected_)
+		return;
+
+	log_call();
+
+	n = size();
+
+	x_.resize(n);
+	y_.resize(n);
+
+	for (i=0; i<n; i++) {
+		utm = to_utm(lat_[i], lon_[i]);
+
+		x_[i] = utm.x;
+		y_[i] = utm.y;
+	}
+
+	projected_ = true;
+}
+
+
+/**
+ * Rauch-Tung-Striebel smoother on one axis, constant velocity model.
+ * Forward pass is a Kalman filter (predicted & filtered states are kept),
+ * backward pass corrects each state with the smoothed next one.
+ */
+static void rts(const int64_t *time, const double *z, size_t n, double accel, double noise, double *out) {
+	size_t i;
+
+	double dt;
+
+	KalmanFilter<2, 1> filter;
+
+	KalmanMatrix<2, 2> gain;
+	KalmanMatrix<2, 2> inverse;
+	KalmanMatrix<2, 1> state;
+
+	std::vector<KalmanMatrix<2, 1> > predicted_state(n), filtered_state(n);
+	std::vector<KalmanMatrix<2, 2> > predicted_covariance(n), filtered_covariance(n);
+
+	if (n == 0)
+		return;
+
+	filter.observation_model[0][0] = 1.0;
+	filter.observation_noise_covariance[0][0] = noise * noise;
+
+	// Start at the first measure, speed unknown
+	filter.state_estimate[0][0] = z[0];
+	filter.estimate_covariance[0][0] = noise * noise;
+	filter.estimate_covariance[1][1] = 100.0;
+
+	predicted_state[0] = filter.state_estimate;
+	predicted_covariance[0] = filter.estimate_covariance;
+	filtered_state[0] = filter.state_estimate;
+	filtered_covariance[0] = filter.estimate_covariance;
+
+	// Forward
+	for (i=1; i<n; i++) {
+		dt = (time[i] - time[i-1]) / 1000.0;
+
+		filter.state_transition[0][1] = dt;
+
+		// White acceleration noise
+		filter.process_noise_covariance[0][0] = accel * accel * dt * dt * dt * dt / 4.0;
+		filter.process_noise_covariance[0][1] = accel * accel * dt * dt * dt / 2.0;
+		filter.process_noise_covariance[1][0] = accel * accel * dt * dt * dt / 2.0;
+		filter.process_noise_covariance[1][1] = accel * accel * dt * dt;
+
+		filter.observation[0][0] = z[i];
+
+		filter.predict();
+
+		predicted_state[i] = filter.predicted_state;
+		predicted_covariance[i] = filter.predicted_estimate_covariance;
+
+		filter.estimate();
+
+		filtered_state[i] = filter.state_estimate;
+		filtered_covariance[i] = filter.estimate_covariance;
+	}
+
+	// Backward
+	state = filtered_state[n - 1];
+	out[n - 1] = state[0][0];
+
+	for (i=n-1; i-- > 0; ) {
+		dt = (time[i+1] - time[i]) / 1000.0;
+
+		filter.state_transition[0][1] = dt;
+
+		if (!predicted_covariance[i+1].invert(inverse)) {
+			state = filtered_state[i];
+		}
+		else {
+			gain = filtered_covariance[i] * filter.state_transition.transpose() * inverse;
+			state = filtered_state[i] + gain * (state - predicted_state[i+1]);
+		}
+
+		out[i] = state[0][0];
+	}
+}
+
+
+void GPXStore::smooth(void) const {
+	size_t i, n;
+
+	std::atomic<size_t> next(0);
+
+	std::vector<std::thread> threads;
+
+	if (smoothed_)
+		return;
+
+	std::lock_guard<std::mutex> lock(smooth_mutex_);
+
+	if (smoothed_)
+		return;
+
+	log_call();
+
+	n = size();
+
+	smooth_lat_.resize(n);
+	smooth_lon_.resize(n);
+	smooth_ele_.resize(n);
+
+	// Segments are independent tracks, one worker takes the next one
+	auto worker = [&]() {
+		size_t j, k;
+
+		std::vector<double> x, y;
+
+		while ((k = next++) < segments_.size()) {
+			size_t begin = segments_[k];
+			size_t end = (k + 1 < segments_.size()) ? segments_[k + 1] : n;
+
+			if (begin >= end)
+				continue;
+
+			// Local metric frame around the segment start
+			double lat0 = lat_[begin];
+			double scale_lat = 111320.0;
+			double scale_lon = 111320.0 * cos(lat0 * M_PI / 180.0);
+
+			x.resize(end - begin);
+			y.resize(end - begin);
+
+			for (j=begin; j<end; j++) {
+				y[j - begin] = (lat_[j] - lat0) * scale_lat;
+				x[j - begin] = (lon_[j] - lon_[begin]) * scale_lon;
+			}
+
+			rts(&time_[begin], y.data(), end - begin, GPXSTORE_SMOOTH_ACCEL, GPXSTORE_SMOOTH_POSITION, y.data());
+			rts(&time_[begin], x.data(), end - begin, GPXSTORE_SMOOTH_ACCEL, GPXSTORE_SMOOTH_POSITION, x.data());
+			rts(&time_[begin], &ele_[begin], end - begin, GPXSTORE_SMOOTH_ACCEL, GPXSTORE_SMOOTH_ELEVATION, &smooth_ele_[begin]);
+
+			for (j=begin; j<end; j++) {
+				smooth_lat_[j] = lat0 + y[j - begin] / scale_lat;
+				smooth_lon_[j] = lon_[begin] + ((scale_lon > 0) ? x[j - begin] / scale_lon : 0.0);
+			}
+		}
+	};
+
+	for (i=1; i<std::min<size_t>(segments_.size(), std::max(1u, std::thread::hardware_concurrency())); i++)
+		threads.push_back(std::thread(worker));
+
+	worker();
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	smoothed_ = true;
+}
+
+
+size_t GPXStore::find(int64_t time_ms) const {
+	std::vector<int64_t>::const_iterator iter;
+
+	// Last point at or before time_ms
+	iter = std::upper_bound(time_.begin(), time_.end(), time_ms);
+
+	if (iter == time_.begin())
+		return 0;
+
+	return (iter - time_.begin()) - 1;
+}
+
+
+void GPXStore::compute(void) {
+	size_t k, n = size();
+	size_t nbr_chunks, chunk;
+
+	std::vector<double> raw(n, 0.0);
+	std::vector<double> distance_sums, moving_sums;
+
+	log_call();
+
+	distance_.assign(n, 0.0);
+	speed_.assign(n, 0.0);
+	grade_.assign(n, 0.0);
+	moving_.assign(n, 0.0);
+
+	if (n == 0)
+		return;
+
+	// One chunk per thread, and not too small ones
+	nbr_chunks = std::max(1u, std::thread::hardware_concurrency());
+	nbr_chunks = std::min(nbr_chunks, (n + GPXSTORE_CHUNK_SIZE - 1) / GPXSTORE_CHUNK_SIZE);
+	chunk = (n + nbr_chunks - 1) / nbr_chunks;
+
+	distance_sums.assign(nbr_chunks, 0.0);
+	moving_sums.assign(nbr_chunks, 0.0);
+
+	auto run = [&](std::function<void (size_t, size_t, size_t)> fn) {
+		std::vector<std::thread> threads;
+
+		for (size_t c=1; c<nbr_chunks; c++)
+			threads.push_back(std::thread(fn, c, c * chunk, std::min(n, (c + 1) * chunk)));
+
+		fn(0, 0, std::min(n, chunk));
+
+		for (std::thread &thread : threads)
+			thread.join();
+	};
+
+	// Per point values: segment length, raw speed & grade
+	run([&](size_t, size_t begin, size_t end) {
+		double d, dt;
+
+		size_t first = std::max<size_t>(begin, 1);
+
+		if (first >= end)
+			return;
+
+		// Batch of segments first-1 -> end-1 (out[0] is the previous chunk one)
+		std::vector<double> segments(end - first + 1);
+
+		Distance::segments(&lat_[first - 1], &lon_[first - 1], segments.size(), segments.data());
+
+		for (size_t i=first; i<end; i++) {
+			d = segments[i - first + 1];
+			dt = (time_[i] - time_[i-1]) / 1000.0;
+
+			distance_[i] = d;
+			raw[i] = (dt > 0) ? (3600.0 * d) / (1000.0 * dt) : -1.0;
+			grade_[i] = (d > 0) ? 100.0 * (ele_[i] - ele_[i-1]) / d : 0.0;
+		}
+	});
+
+	// Skip GPS glitches: a speed is compared to the last accepted one, so this
+	// pass is sequential (it's a single cheap loop)
+	for (size_t i=1; i<n; i++) {
+		if ((raw[i] < 0) || (fabs(raw[i] - speed_[i-1]) >= GPXSTORE_SPEED_GLITCH))
+			speed_[i] = speed_[i-1];
+		else
+			speed_[i] = raw[i];
+	}
+
+	// Local cumulative sums
+	run([&](size_t k, size_t begin, size_t end) {
+		double distance = 0.0;
+		double moving = 0.0;
+
+		for (size_t i=std::max<size_t>(begin, 1); i<end; i++) {
+			distance += distance_[i];
+
+			if (speed_[i] >= GPXSTORE_MOVING_SPEED)
+				moving += (time_[i] - time_[i-1]) / 1000.0;
+
+			distance_[i] = distance;
+			moving_[i] = moving;
+		}
+
+		distance_sums[k] = distance;
+		moving_sums[k] = moving;
+	});
+
+	// Chunk offsets (prefix sum over the chunk totals)
+	for (k=1; k<nbr_chunks; k++) {
+		distance_sums[k] += distance_sums[k-1];
+		moving_sums[k] += moving_sums[k-1];
+	}
+
+	run([&](size_t k, size_t begin, size_t end) {
+		if (k == 0)
+			return;
+
+		for (size_t i=begin; i<end; i++) {
+			distance_[i] += distance_sums[k-1];
+			moving_[i] += moving_sums[k-1];
+		}
+	});
+}
+
+
+std::string GPXStore::info(const std::string &name) const {
+	std::map<std::string, std::string>::const_iterator iter = info_.find(name);
+
+	if (iter == info_.end())
+		return "";
+
+	return iter->second;
+}
+
+
+void GPXStore::setInfo(const std::string &name, const std::string &value) {
+	info_[name] = value;
+}
+
+
+const char * GPXStore::localName(const char *name) {
+	const char *s = strrchr(name, ':');
+
+	return (s != NULL) ? s + 1 : name;
+}
+
+
+void GPXStore::startElementHandler(void *userData, const char *name, const char **atts) {
+	GPXStore *self = static_cast<GPXStore *>(userData);
+
+	name = localName(name);
+
+	self->depth_++;
+	self->text_.clear();
+
+	// Parse only the first track (GPX) or activity (TCX)
+	if (!self->in_trk_) {
+		if ((strcasecmp(name, "trk") == 0) || (strcasecmp(name, "Activity") == 0) || (strcasecmp(name, "Course") == 0)) {
+			self->in_trk_ = true;
+			self->trk_depth_ = self->depth_;
+
+			for (int i=0; atts[i] != NULL; i+=2) {
+				if (strcasecmp(atts[i], "Sport") == 0)
+					self->info_["type"] = atts[i+1];
+			}
+		}
+
+		return;
+	}
+
+	if (self->in_pt_) {
+		if (strcasecmp(name, "extensions") == 0)
+			self->in_extensions_ = true;
+	}
+	else if ((strcasecmp(name, "trkseg") == 0) || (strcasecmp(name, "Track") == 0)) {
+		self->split();
+	}
+	else if ((strcasecmp(name, "trkpt") == 0) || (strcasecmp(name, "Trackpoint") == 0)) {
+		self->in_pt_ = true;
+
+		self->pt_.line = XML_GetCurrentLineNumber(self->parser_);
+		self->pt_.valid = false;
+		self->pt_.has_position = false;
+		self->pt_.lat = 0.0;
+		self->pt_.lon = 0.0;
+		self->pt_.ele = 0.0;
+		self->pt_.temperature = NAN;
+		self->pt_.cadence = GPXSTORE_NO_VALUE;
+		self->pt_.heartrate = GPXSTORE_NO_VALUE;
+		self->pt_.power = GPXSTORE_NO_VALUE;
+
+		for (int i=0; atts[i] != NULL; i+=2) {
+			if (strcasecmp(atts[i], "lat") == 0)
+				self->pt_.lat = strtod(atts[i+1], NULL);
+			else if (strcasecmp(atts[i], "lon") == 0)
+				self->pt_.lon = strtod(atts[i+1], NULL);
+			else
+				continue;
+
+			self->pt_.has_position = true;
+		}
+	}
+}
+
+
+void GPXStore::endElementHandler(void *userData, const char *name) {
+	GPXStore *self = static_cast<GPXStore *>(userData);
+
+	const char *value = self->text_.c_str();
+
+	name = localName(name);
+
+	if (!self->in_trk_)
+		goto done;
+
+	if (self->in_pt_) {
+		if ((strcasecmp(name, "trkpt") == 0) || (strcasecmp(name, "Trackpoint") == 0)) {
+			self->in_pt_ = false;
+
+			// Skip point if time or position isn't valid
+			if (self->pt_.valid && self->pt_.has_position) {
+				self->append(self->pt_.line, self->pt_.time, self->pt_.lat, self->pt_.lon, self->pt_.ele,
+					self->pt_.temperature, self->pt_.cadence, self->pt_.heartrate, self->pt_.power);
+			}
+		}
+		else if (self->in_extensions_) {
+			if (strcasecmp(name, "extensions") == 0)
+				self->in_extensions_ = false;
+			else if (strstr(name, "atemp") != NULL)
+				self->pt_.temperature = strtod(value, NULL);
+			else if (strstr(name, "cad") != NULL)
+				self->pt_.cadence = strtol(value, NULL, 10);
+			else if (strstr(name, "hr") != NULL)
+				self->pt_.heartrate = strtol(value, NULL, 10);
+			else if ((strstr(name, "power") != NULL) || (strcasecmp(name, "Watts") == 0))
+				self->pt_.power = strtol(value, NULL, 10);
+		}
+		else if ((strcasecmp(name, "ele") == 0) || (strcasecmp(name, "AltitudeMeters") == 0))
+			self->pt_.ele = strtod(value, NULL);
+		else if (strcasecmp(name, "time") == 0)
+			self->pt_.valid = ::parse_datetime_ms(value, &self->pt_.time);
+		// TCX values
+		else if (strcasecmp(name, "LatitudeDegrees") == 0)
+			self->pt_.lat = strtod(value, NULL);
+		else if (strcasecmp(name, "LongitudeDegrees") == 0) {
+			self->pt_.lon = strtod(value, NULL);
+			self->pt_.has_position = true;
+		}
+		else if (strcasecmp(name, "Value") == 0)	// HeartRateBpm
+			self->pt_.heartrate = strtol(value, NULL, 10);
+		else if (strcasecmp(name, "Cadence") == 0)
+			self->pt_.cadence = strtol(value, NULL, 10);
+	}
+	else if (self->depth_ == self->trk_depth_) {
+		// End of the first track, skip the rest of the file
+		self->in_trk_ = false;
+		self->done_ = true;
+
+		XML_StopParser(self->parser_, XML_FALSE);
+	}
+	else if (self->depth_ == self->trk_depth_ + 1) {
+		// Track info: name, cmt, desc... (elements with only child elements are skipped)
+		if (self->text_.find_first_not_of(" \t\r\n") != std::string::npos)
+			self->info_[name] = self->text_;
+	}
+
+done:
+	self->depth_--;
+	self->text_.clear();
+}
+
+
+void GPXStore::characterDataHandler(void *userData, const char *s, int len) {
+	GPXStore *self = static_cast<GPXStore *>(userData);
+
+	// Text buffer is reused from one element to the next
+	if (self->in_trk_)
+		self->text_.append(s, len);
+}
+
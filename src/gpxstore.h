@@ -0,0 +1,312 @@
+#ifndef __GPX2VIDEO__GPXSTORE_H__
+#define __GPX2VIDEO__GPXSTORE_H__
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <math.h>
+
+#include <expat.h>
+
+
+// Missing extension values
+#define GPXSTORE_NO_VALUE -1
+
+// File read chunk size
+#define GPXSTORE_READ_SIZE (64 * 1024)
+
+// GPX files from this size are parsed by chunks on every core
+#define GPXSTORE_PARALLEL_SIZE (16 * 1024 * 1024)
+
+// Size of the text parsed by one worker (split at <trkpt> tags)
+#define GPXSTORE_PARSE_CHUNK_SIZE (4 * 1024 * 1024)
+
+// Points per thread when computing derived values
+#define GPXSTORE_CHUNK_SIZE 4096
+
+// Speed below which time isn't counted as moving (km/h)
+#define GPXSTORE_MOVING_SPEED 2.0
+
+// Speed change between two points considered as a GPS glitch (km/h)
+#define GPXSTORE_SPEED_GLITCH 50.0
+
+// Smoother model: acceleration noise (m/s^2) & measurement noise (m)
+#define GPXSTORE_SMOOTH_ACCEL 1.0
+#define GPXSTORE_SMOOTH_POSITION 5.0
+#define GPXSTORE_SMOOTH_ELEVATION 3.0
+
+
+/**
+ * Track points stored column by column (one array per field).
+ * GPX & TCX files are streamed through expat straight into the columns: no
+ * DOM is built and values are converted from strings only once. Large GPX
+ * files are split at track points and parsed by chunks in parallel. FIT files
+ * are decoded by FITReader.
+ */
+class GPXStore {
+public:
+	GPXStore();
+	virtual ~GPXStore();
+
+	static GPXStore * open(const std::string &filename);
+
+	// Parse once, shared by every reader of the same file
+	static std::shared_ptr<const GPXStore> get(const std::string &filename);
+
+	void clear(void);
+	void reserve(size_t n);
+
+	void append(int line, int64_t time_ms, double lat, double lon, double ele,
+		double temperature=NAN, int cadence=GPXSTORE_NO_VALUE, int heartrate=GPXSTORE_NO_VALUE,
+		int power=GPXSTORE_NO_VALUE);
+
+	// Next appended point starts a new track segment
+	void split(void);
+
+	// Sort points by time (done once the store is filled)
+	void index(void);
+
+	// Index of the last point at or before time_ms, O(log n)
+	size_t find(int64_t time_ms) const;
+
+	// Derive distance, speed, grade & moving time (done once the store is indexed)
+	void compute(void);
+
+	// Track info (name, cmt, desc, src, type, number)
+	std::string info(const std::string &name) const;
+	void setInfo(const std::string &name, const std::string &value);
+
+	size_t size(void) const {
+		return time_.size();
+	}
+
+	bool empty(void) const {
+		return time_.empty();
+	}
+
+	// Point index of each segment start
+	const std::vector<size_t>& segments(void) const {
+		return segments_;
+	}
+
+	// Columns
+	const std::vector<int64_t>& times(void) const {
+		return time_;
+	}
+
+	const std::vector<double>& lats(void) const {
+		return lat_;
+	}
+
+	const std::vector<double>& lons(void) const {
+		return lon_;
+	}
+
+	const std::vector<double>& eles(void) const {
+		return ele_;
+	}
+
+	// Point i
+	const int& line(size_t i) const {
+		return line_[i];
+	}
+
+	const int64_t& time(size_t i) const {
+		return time_[i];
+	}
+
+	const double& lat(size_t i) const {
+		return lat_[i];
+	}
+
+	const double& lon(size_t i) const {
+		return lon_[i];
+	}
+
+	const double& ele(size_t i) const {
+		return ele_[i];
+	}
+
+	// UTM projection, computed for the whole track on first use
+	const double& x(size_t i) const {
+		project();
+		return x_[i];
+	}
+
+	const double& y(size_t i) const {
+		project();
+		return y_[i];
+	}
+
+	const std::vector<double>& xs(void) const {
+		project();
+		return x_;
+	}
+
+	const std::vector<double>& ys(void) const {
+		project();
+		return y_;
+	}
+
+	// Smoothed positions (RTS smoother), computed for the whole track on first use
+	const double& smoothLat(size_t i) const {
+		smooth();
+		return smooth_lat_[i];
+	}
+
+	const double& smoothLon(size_t i) const {
+		smooth();
+		return smooth_lon_[i];
+	}
+
+	const double& smoothEle(size_t i) const {
+		smooth();
+		return smooth_ele_[i];
+	}
+
+	void smooth(void) const;
+
+	const double& temperature(size_t i) const {
+		return temperature_[i];
+	}
+
+	const int& cadence(size_t i) const {
+		return cadence_[i];
+	}
+
+	const int& heartrate(size_t i) const {
+		return heartrate_[i];
+	}
+
+	const int& power(size_t i) const {
+		return power_[i];
+	}
+
+	// Derived values, speed & grade are over the segment ending at point i
+	const double& distance(size_t i) const {
+		return distance_[i];
+	}
+
+	const double& speed(size_t i) const {
+		return speed_[i];
+	}
+
+	const double& grade(size_t i) const {
+		return grade_[i];
+	}
+
+	const double& movingTime(size_t i) const {
+		return moving_[i];
+	}
+
+	const std::vector<double>& speeds(void) const {
+		return speed_;
+	}
+
+	bool hasTemperature(size_t i) const {
+		return !std::isnan(temperature_[i]);
+	}
+
+	bool hasCadence(size_t i) const {
+		return (cadence_[i] != GPXSTORE_NO_VALUE);
+	}
+
+	bool hasHeartrate(size_t i) const {
+		return (heartrate_[i] != GPXSTORE_NO_VALUE);
+	}
+
+	bool hasPower(size_t i) const {
+		return (power_[i] != GPXSTORE_NO_VALUE);
+	}
+
+private:
+	friend class GPXCache;
+
+	struct Entry {
+		time_t mtime;
+		off_t size;
+		std::shared_ptr<const GPXStore> store;
+	};
+
+	static std::mutex registry_mutex_;
+	static std::map<std::string, Entry> registry_;
+
+	void project(void) const;
+
+	// Parallel parsing of a large GPX file, NULL if the file doesn't suit it
+	static GPXStore * parseChunks(const std::string &filename);
+
+	static const char * localName(const char *name);
+
+	static void startElementHandler(void *userData, const char *name, const char **atts);
+	static void endElementHandler(void *userData, const char *name);
+	static void characterDataHandler(void *userData, const char *s, int len);
+
+	// Parser state
+	XML_Parser parser_;
+
+	int depth_;
+	int trk_depth_;
+	bool in_trk_;
+	bool in_pt_;
+	bool in_extensions_;
+	bool done_;
+
+	std::string text_;
+
+	struct {
+		bool valid;
+		bool has_position;
+		int line;
+		int64_t time;
+		double lat, lon, ele;
+		double temperature;
+		int cadence;
+		int heartrate;
+		int power;
+	} pt_;
+
+	std::map<std::string, std::string> info_;
+
+	bool split_;
+
+	std::vector<size_t> segments_;
+
+	std::vector<int> line_;
+	std::vector<int64_t> time_;
+	std::vector<double> lat_;
+	std::vector<double> lon_;
+	std::vector<double> ele_;
+
+	// Lazy UTM columns
+	mutable std::mutex utm_mutex_;
+	mutable std::atomic<bool> projected_;
+	mutable std::vector<double> x_;
+	mutable std::vector<double> y_;
+
+	// Lazy smoothed columns
+	mutable std::mutex smooth_mutex_;
+	mutable std::atomic<bool> smoothed_;
+	mutable std::vector<double> smooth_lat_;
+	mutable std::vector<double> smooth_lon_;
+	mutable std::vector<double> smooth_ele_;
+
+	std::vector<double> temperature_;
+	std::vector<int> cadence_;
+	std::vector<int> heartrate_;
+	std::vector<int> power_;
+
+	// Derived columns
+	std::vector<double> distance_;
+	std::vector<double> speed_;
+	std::vector<double> grade_;
+	std::vector<double> moving_;
+};
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef __GPX2VIDEO__KALMANFILTER_H__
+#define __GPX2VIDEO__KALMANFILTER_H__
+
+#include <math.h>
+
+
+/**
+ * Fixed size matrix, stored inline (no heap allocation).
+ * Dimensions are compile time constants, so loops are unrolled by the compiler.
+ */
+template <int R, int C>
+struct KalmanMatrix {
+	double m[R][C];
+
+	double * operator[](int i) {
+		return m[i];
+	}
+
+	const double * operator[](int i) const {
+		return m[i];
+	}
+
+	void zero(void) {
+		for (int i=0; i<R; i++)
+			for (int j=0; j<C; j++)
+				m[i][j] = 0.0;
+	}
+
+	void identity(void) {
+		for (int i=0; i<R; i++)
+			for (int j=0; j<C; j++)
+				m[i][j] = (i == j) ? 1.0 : 0.0;
+	}
+
+	KalmanMatrix<R, C> operator+(const KalmanMatrix<R, C> &b) const {
+		KalmanMatrix<R, C> c;
+
+		for (int i=0; i<R; i++)
+			for (int j=0; j<C; j++)
+				c.m[i][j] = m[i][j] + b.m[i][j];
+
+		return c;
+	}
+
+	KalmanMatrix<R, C> operator-(const KalmanMatrix<R, C> &b) const {
+		KalmanMatrix<R, C> c;
+
+		for (int i=0; i<R; i++)
+			for (int j=0; j<C; j++)
+				c.m[i][j] = m[i][j] - b.m[i][j];
+
+		return c;
+	}
+
+	template <int K>
+	KalmanMatrix<R, K> operator*(const KalmanMatrix<C, K> &b) const {
+		KalmanMatrix<R, K> c;
+
+		for (int i=0; i<R; i++) {
+			for (int j=0; j<K; j++) {
+				double sum = 0.0;
+
+				for (int k=0; k<C; k++)
+					sum += m[i][k] * b.m[k][j];
+
+				c.m[i][j] = sum;
+			}
+		}
+
+		return c;
+	}
+
+	KalmanMatrix<C, R> transpose(void) const {
+		KalmanMatrix<C, R> t;
+
+		for (int i=0; i<R; i++)
+			for (int j=0; j<C; j++)
+				t.m[j][i] = m[i][j];
+
+		return t;
+	}
+
+	// Gauss-Jordan elimination with partial pivoting (square matrices only)
+	bool invert(KalmanMatrix<R, C> &output) const {
+		KalmanMatrix<R, C> a = *this;
+
+		output.identity();
+
+		for (int i=0; i<R; i++) {
+			int p = i;
+
+			for (int r=i+1; r<R; r++) {
+				if (fabs(a.m[r][i]) > fabs(a.m[p][i]))
+					p = r;
+			}
+
+			if (a.m[p][i] == 0.0)
+				return false;
+
+			if (p != i) {
+				for (int j=0; j<C; j++) {
+					double t;
+
+					t = a.m[i][j]; a.m[i][j] = a.m[p][j]; a.m[p][j] = t;
+					t = output.m[i][j]; output.m[i][j] = output.m[p][j]; output.m[p][j] = t;
+				}
+			}
+
+			double scalar = 1.0 / a.m[i][i];
+
+			for (int j=0; j<C; j++) {
+				a.m[i][j] *= scalar;
+				output.m[i][j] *= scalar;
+			}
+
+			for (int r=0; r<R; r++) {
+				if (r == i)
+					continue;
+
+				double shear = -a.m[r][i];
+
+				for (int j=0; j<C; j++) {
+					a.m[r][j] += shear * a.m[i][j];
+					output.m[r][j] += shear * output.m[i][j];
+				}
+			}
+		}
+
+		return true;
+	}
+};
+
+
+/**
+ * Kalman filter, N state & M observation dimensions.
+ * Every matrix is a member, so a filter is a plain value: copying a GPXData
+ * copies its filter state, and nothing is allocated per point.
+ * See http://en.wikipedia.org/wiki/Kalman_filter for the notation.
+ */
+template <int N, int M>
+class KalmanFilter {
+public:
+	KalmanFilter() {
+		state_transition.identity();
+		observation_model.zero();
+		process_noise_covariance.zero();
+		observation_noise_covariance.zero();
+		observation.zero();
+		predicted_state.zero();
+		predicted_estimate_covariance.zero();
+		state_estimate.zero();
+		estimate_covariance.zero();
+	}
+
+	// Prediction + estimation
+	void update(void) {
+		predict();
+		estimate();
+	}
+
+	void predict(void) {
+		// x-hat_k|k-1 = F x-hat_k-1|k-1
+		predicted_state = state_transition * state_estimate;
+
+		// P_k|k-1 = F P_k-1|k-1 F^T + Q
+		predicted_estimate_covariance = state_transition * estimate_covariance * state_transition.transpose()
+			+ process_noise_covariance;
+	}
+
+	void estimate(void) {
+		KalmanMatrix<N, M> vertical;
+		KalmanMatrix<M, M> inverse_innovation_covariance;
+		KalmanMatrix<N, N> identity;
+
+		// y-tilde_k = z_k - H x-hat_k|k-1
+		KalmanMatrix<M, 1> innovation = observation - observation_model * predicted_state;
+
+		// S_k = H P_k|k-1 H^T + R
+		vertical = predicted_estimate_covariance * observation_model.transpose();
+
+		KalmanMatrix<M, M> innovation_covariance = observation_model * vertical + observation_noise_covariance;
+
+		if (!innovation_covariance.invert(inverse_innovation_covariance))
+			return;
+
+		// K_k = P_k|k-1 H^T S_k^-1
+		KalmanMatrix<N, M> optimal_gain = vertical * inverse_innovation_covariance;
+
+		// x-hat_k|k = x-hat_k|k-1 + K_k y-tilde_k
+		state_estimate = predicted_state + optimal_gain * innovation;
+
+		// P_k|k = (I - K_k H) P_k|k-1
+		identity.identity();
+
+		estimate_covariance = (identity - optimal_gain * observation_model) * predicted_estimate_covariance;
+	}
+
+	// Model (F, H, Q, R), set by the user
+	KalmanMatrix<N, N> state_transition;
+	KalmanMatrix<M, N> observation_model;
+	KalmanMatrix<N, N> process_noise_covariance;
+	KalmanMatrix<M, M> observation_noise_covariance;
+
+	// Observation (z), set before each update
+	KalmanMatrix<M, 1> observation;
+
+	// Updated by the filter
+	KalmanMatrix<N, 1> predicted_state;
+	KalmanMatrix<N, N> predicted_estimate_covariance;
+	KalmanMatrix<N, 1> state_estimate;
+	KalmanMatrix<N, N> estimate_covariance;
+};
+
+
+/**
+ * Constant velocity model on (lat, lon): state is x, y, x', y' and only
+ * the position is observed. Same model & units as the previous C filter
+ * (thousandths of degree, velocity in thousandths of position per second).
+ */
+class KalmanVelocity2D : public KalmanFilter<4, 2> {
+public:
+	KalmanVelocity2D(double noise=10.0) {
+		const double pos = 0.000001;
+
+		setSecondsPerTimestep(1.0);
+
+		// We observe (x, y) in each time step
+		observation_model[0][0] = 1.0;
+		observation_model[1][1] = 1.0;
+
+		// Noise in the world
+		process_noise_covariance[0][0] = pos;
+		process_noise_covariance[1][1] = pos;
+		process_noise_covariance[2][2] = 1.0;
+		process_noise_covariance[3][3] = 1.0;
+
+		// Noise in our observation
+		observation_noise_covariance[0][0] = pos * noise;
+		observation_noise_covariance[1][1] = pos * noise;
+
+		// The start position is totally unknown, so give a high variance
+		estimate_covariance.identity();
+
+		for (int i=0; i<4; i++)
+			estimate_covariance[i][i] = 1000.0 * 1000.0 * 1000.0 * 1000.0;
+	}
+
+	void setSecondsPerTimestep(double seconds) {
+		state_transition[0][2] = 0.001 * seconds;
+		state_transition[1][3] = 0.001 * seconds;
+	}
+
+	void update(double lat, double lon, double seconds) {
+		setSecondsPerTimestep(seconds);
+
+		observation[0][0] = lat * 1000.0;
+		observation[1][0] = lon * 1000.0;
+
+		KalmanFilter<4, 2>::update();
+	}
+
+	void update(void) {
+		KalmanFilter<4, 2>::update();
+	}
+
+	void position(double *lat, double *lon) const {
+		*lat = state_estimate[0][0] / 1000.0;
+		*lon = state_estimate[1][0] / 1000.0;
+	}
+};
+
+#endif
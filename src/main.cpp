@@ -17,6 +17,7 @@ extern "C" {
 #include "timesync.h"
 #include "extractor.h"
 #include "telemetry.h"
+#include "distance.h"
 #include "gpx2video.h"
 
 
@@ -29,12 +30,18 @@ static const struct option options[] = {
 	{ "format",           required_argument, 0, 'f' },
 	{ "duration",         required_argument, 0, 'd' },
 	{ "trim",             required_argument, 0, 0 },
+	{ "timelapse",        required_argument, 0, 0 },
+	{ "checkpoint",       required_argument, 0, 0 },
+	{ "rendition",        required_argument, 0, 0 },
+	{ "live",             required_argument, 0, 0 },
+	{ "overlay-cache",    no_argument,       0, 0 },
 	{ "media",            required_argument, 0, 'm' },
 	{ "gpx",              required_argument, 0, 'g' },
 	{ "layout",           required_argument, 0, 'l' },
 	{ "output",           required_argument, 0, 'o' },
 	{ "offset",           required_argument, 0, 0 },
 	{ "telemetry",        required_argument, 0, 't' },
+	{ "distance",         required_argument, 0, 0 },
 	{ "map-source",       required_argument, 0, 0 },
 	{ "map-factor",       required_argument, 0, 0 },
 	{ "map-zoom",         required_argument, 0, 0 },
@@ -61,8 +68,14 @@ static void print_usage(const std::string &name) {
 	std::cout << "\t- o, --output=file      : Output file name" << std::endl;
 	std::cout << "\t- d, --duration         : Duration (in ms)" << std::endl;
 	std::cout << "\t-    --trim             : Left trim crop (in ms)" << std::endl;
+	std::cout << "\t-    --timelapse        : Timelapse factor, keep 1 frame every N (default: 1)" << std::endl;
+	std::cout << "\t-    --checkpoint       : Resumable render, save a checkpoint every N seconds" << std::endl;
+	std::cout << "\t-    --rendition        : Extra output from the same decode (file,layout,WxH[,kbps[,preset]])" << std::endl;
+	std::cout << "\t-    --live             : Real-time mode for a live input, latency budget (in ms)" << std::endl;
+	std::cout << "\t-    --overlay-cache    : Keep rendered widgets on disk, a next run only blends them" << std::endl;
 	std::cout << "\t- f, --format=name      : Extract format (dump, gpx)" << std::endl;
 	std::cout << "\t- t, --telemetry=filter : Filter GPX values (none, kalman)" << std::endl;
+	std::cout << "\t-    --distance         : Distance computation (0: geodesic, 1: haversine)" << std::endl;
 	std::cout << "\t-    --offset           : Add a time offset (in ms)" << std::endl;
 	std::cout << "\t-    --map-factor       : Map factor (default: 1.0)" << std::endl;
 	std::cout << "\t-    --map-source       : Map source" << std::endl;
@@ -158,6 +171,12 @@ int GPX2Video::parseCommandLine(int argc, char *argv[]) {
 	int verbose = 0;
 	int map_zoom = 12;
 	int max_duration_ms = 0; // By default process whole media
+	int trim_ms = 0; // By default process from media start
+	int timelapse = 1; // By default keep each frame
+	int checkpoint = 0; // By default render isn't resumable
+	int live_ms = 0; // By default input isn't a live stream
+
+	bool overlay_cache = false; // By default widgets are rendered for each run
 
 	double map_factor = 1.0;
 
@@ -173,6 +192,8 @@ int GPX2Video::parseCommandLine(int argc, char *argv[]) {
 	std::string gpx_to;
 	std::string gpx_from;
 
+	std::list<RendererSettings> renditions;
+
 	ExtractorSettings::Format extract_format = ExtractorSettings::FormatDump;
 
 	TelemetrySettings::Filter telemetry_filter = TelemetrySettings::FilterNone;
@@ -200,9 +221,39 @@ int GPX2Video::parseCommandLine(int argc, char *argv[]) {
 				offset = atoi(optarg);
 			}
 			else if (s && !strcmp(s, "trim")) {
-				// TODO
-				printf("Not yet implemented\n");
-				return 0;
+				trim_ms = atoi(optarg);
+			}
+			else if (s && !strcmp(s, "timelapse")) {
+				timelapse = atoi(optarg);
+			}
+			else if (s && !strcmp(s, "checkpoint")) {
+				checkpoint = atoi(optarg);
+			}
+			else if (s && !strcmp(s, "rendition")) {
+				RendererSettings rendition;
+
+				if (RendererSettings::parse(optarg, rendition) == false) {
+					std::cout << name << ": option '--rendition' value '" << optarg << "' invalid" << std::endl;
+					return -1;
+				}
+
+				renditions.push_back(rendition);
+			}
+			else if (s && !strcmp(s, "live")) {
+				live_ms = atoi(optarg);
+			}
+			else if (s && !strcmp(s, "overlay-cache")) {
+				overlay_cache = true;
+			}
+			else if (s && !strcmp(s, "distance")) {
+				int accuracy = atoi(optarg);
+
+				if ((accuracy < 0) || (accuracy >= Distance::AccuracyCount)) {
+					std::cout << name << ": option '--distance' value '" << optarg << "' invalid" << std::endl;
+					return -1;
+				}
+
+				Distance::setAccuracy((Distance::Accuracy) accuracy);
 			}
 			else if (s && !strcmp(s, "map-list")) {
 				setCommand(GPX2Video::CommandSource);
@@ -372,6 +423,16 @@ int GPX2Video::parseCommandLine(int argc, char *argv[]) {
 		return -1;
 	}
 
+	if (timelapse < 1) {
+		std::cout << name << ": option '--timelapse' must be greater than 0" << std::endl;
+		return -1;
+	}
+
+	if ((live_ms > 0) && ((timelapse > 1) || (checkpoint > 0) || (trim_ms > 0))) {
+		std::cout << name << ": option '--live' can't be used with '--timelapse', '--checkpoint' or '--trim'" << std::endl;
+		return -1;
+	}
+
 	setProgressInfo((verbose > 0));
 
 	// Save app settings
@@ -388,7 +449,13 @@ int GPX2Video::parseCommandLine(int argc, char *argv[]) {
 		gpx_from,
 		gpx_to,
 		extract_format,
-		telemetry_filter)
+		telemetry_filter,
+		timelapse,
+		checkpoint,
+		trim_ms,
+		renditions,
+		live_ms,
+		overlay_cache)
 	);
 
 	return 0;
@@ -489,6 +556,7 @@ int main(int argc, char *argv[], char *envp[]) {
 					log_error("Build map failure.");
 					goto exit;
 				}
+				map->addDependency(cache);
 				app.append(map);
 			}
 			else {
@@ -515,6 +583,7 @@ int main(int argc, char *argv[], char *envp[]) {
 					log_error("Build map failure.");
 					goto exit;
 				}
+				map->addDependency(cache);
 				app.append(map);
 			}
 			else {
@@ -538,12 +607,17 @@ int main(int argc, char *argv[], char *envp[]) {
 		cache = Cache::create(app);
 		app.append(cache);
 
-		// Create gpx2video timesync task
-		timesync = TimeSync::create(app);
-		app.append(timesync);
+		// Create gpx2video timesync task (a live input can't be read twice)
+		if (app.settings().live() == 0) {
+			timesync = TimeSync::create(app);
+			app.append(timesync);
+		}
 
-		// Create gpx2video renderer task
+		// Create gpx2video renderer task (map & widgets tasks run alongside timesync)
 		renderer = Renderer::create(app);
+		renderer->addDependency(cache);
+		if (timesync)
+			renderer->addDependency(timesync);
 		app.append(renderer);
 		break;
 
@@ -53,6 +53,11 @@ void MediaContainer::setStartTime(const std::string &start_time) {
 }
 
 
+void MediaContainer::setStartTime(const time_t &start_time) {
+	start_time_ = start_time;
+}
+
+
 int MediaContainer::timeOffset(void) const {
 	return offset_;
 }
@@ -24,6 +24,7 @@ public:
 
 	time_t startTime(void) const;
 	void setStartTime(const std::string &start_time);
+	void setStartTime(const time_t &start_time);
 
 	int timeOffset(void) const;
 	void setTimeOffset(const int& offset);
@@ -0,0 +1,361 @@
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "log.h"
+#include "utils.h"
+#include "overlaycache.h"
+
+
+OverlayCache::OverlayCache()
+	: hits_(0)
+	, misses_(0) {
+}
+
+
+OverlayCache::~OverlayCache() {
+}
+
+
+OverlayCache * OverlayCache::create(void) {
+	OverlayCache *cache = new OverlayCache();
+
+	cache->init();
+
+	return cache;
+}
+
+
+void OverlayCache::init(void) {
+	log_call();
+
+	path_ = std::getenv("HOME") + std::string("/.gpx2video/cache/overlay");
+	::mkpath(path_, 0700);
+}
+
+
+uint64_t OverlayCache::hashSample(const GPXData &data, const time_t &time, uint64_t seed) {
+	const GPXData::point &pt = data.position();
+
+	// Each value a widget can draw (widget time is the camera time)
+	const double values[] = {
+		pt.lat, pt.lon, pt.ele,
+		data.duration(), data.distance(), data.grade(),
+		data.speed(), data.maxspeed(), data.avgspeed(),
+		data.temperature()
+	};
+
+	const int64_t counters[] = {
+		(int64_t) time, (int64_t) pt.time, pt.valid,
+		data.valid(), data.hasValue(), data.elapsedTime(),
+		data.cadence(), data.heartrate()
+	};
+
+	seed = hashData(values, sizeof(values), seed);
+	seed = hashData(counters, sizeof(counters), seed);
+
+	return seed;
+}
+
+
+std::string OverlayCache::filename(uint64_t key, bool create) {
+	std::ostringstream stream;
+	std::string path;
+
+	// Fan out on the first byte
+	stream << path_ << "/" << std::hex << std::setfill('0') << std::setw(2) << (unsigned int) (key >> 56);
+
+	path = stream.str();
+
+	if (create)
+		::mkpath(path, 0700);
+
+	stream << "/" << std::setw(16) << key << ".rle";
+
+	return stream.str();
+}
+
+
+bool OverlayCache::load(uint64_t key, OIIO::ImageBuf *buf) {
+	size_t size;
+
+	std::vector<uint8_t> data;
+
+	std::ifstream stream(filename(key), std::ios::binary | std::ios::ate);
+
+	if (!stream.is_open())
+		goto miss;
+
+	size = stream.tellg();
+	stream.seekg(0);
+
+	data.resize(size);
+
+	if (!stream.read((char *) data.data(), size))
+		goto miss;
+
+	if (decode(data, buf) == false) {
+		log_warn("Overlay cache entry %016lx is corrupted", (unsigned long) key);
+		goto miss;
+	}
+
+	// Refresh access time, eviction is LRU (mount may be noatime / relatime)
+	{
+		const struct timespec times[2] = { { 0, UTIME_NOW }, { 0, UTIME_OMIT } };
+
+		::utimensat(AT_FDCWD, filename(key).c_str(), times, 0);
+	}
+
+	hits_++;
+
+	return true;
+
+miss:
+	misses_++;
+
+	return false;
+}
+
+
+bool OverlayCache::save(uint64_t key, const OIIO::ImageBuf *buf) {
+	std::string name = filename(key, true);
+	std::string tmpfile = name + ".tmp";
+
+	std::vector<uint8_t> data;
+
+	std::ofstream stream(tmpfile, std::ios::binary);
+
+	if (!stream.is_open())
+		return false;
+
+	encode(buf, data);
+
+	stream.write((const char *) data.data(), data.size());
+
+	if (!stream.fail())
+		stream.close();
+
+	if (stream.fail()) {
+		log_warn("Overlay cache entry '%s' write failure", tmpfile.c_str());
+		goto failure;
+	}
+
+	// Atomic update (a crashed run doesn't leave half an entry)
+	if (::rename(tmpfile.c_str(), name.c_str()) != 0)
+		goto failure;
+
+	return true;
+
+failure:
+	::remove(tmpfile.c_str());
+
+	return false;
+}
+
+
+/**
+ * Remove the least recently used layers until the cache size is under
+ * max_size. Called once a render is done, not per saved layer.
+ */
+void OverlayCache::evict(uint64_t max_size) {
+	DIR *dir, *sub_dir;
+
+	struct stat st;
+	struct dirent *entry, *sub_entry;
+
+	struct file {
+		std::string name;
+		time_t atime;
+		uint64_t size;
+	};
+
+	uint64_t total = 0;
+	unsigned int removed = 0;
+
+	std::vector<struct file> files;
+
+	log_call();
+
+	if ((dir = ::opendir(path_.c_str())) == NULL)
+		return;
+
+	// Fan out directories, then layer files
+	while ((entry = ::readdir(dir)) != NULL) {
+		std::string path = path_ + "/" + entry->d_name;
+
+		if ((entry->d_name[0] == '.') || ((sub_dir = ::opendir(path.c_str())) == NULL))
+			continue;
+
+		while ((sub_entry = ::readdir(sub_dir)) != NULL) {
+			std::string name = path + "/" + sub_entry->d_name;
+
+			if (sub_entry->d_name[0] == '.')
+				continue;
+
+			if ((::stat(name.c_str(), &st) != 0) || !S_ISREG(st.st_mode))
+				continue;
+
+			files.push_back({ name, std::max(st.st_atime, st.st_mtime), (uint64_t) st.st_size });
+			total += st.st_size;
+		}
+
+		::closedir(sub_dir);
+	}
+
+	::closedir(dir);
+
+	if (total <= max_size)
+		return;
+
+	std::sort(files.begin(), files.end(), [](const struct file &a, const struct file &b) {
+		return a.atime < b.atime;
+	});
+
+	for (const struct file &f : files) {
+		if (total <= max_size)
+			break;
+
+		if (::remove(f.name.c_str()) != 0)
+			continue;
+
+		total -= f.size;
+		removed++;
+	}
+
+	log_info("Overlay cache: %u layers evicted (%lu MB left)", removed, (unsigned long) (total / (1024 * 1024)));
+}
+
+
+/**
+ * Sparse RLE layout (host endianness, cache is local):
+ *   header: magic[4], version, width, height, pixel bytes, number of runs
+ *   runs:   transparent pixels, opaque pixels, opaque pixel data
+ * A pixel is transparent if all its bytes are zero.
+ */
+void OverlayCache::encode(const OIIO::ImageBuf *buf, std::vector<uint8_t> &data) {
+	size_t i, n;
+	size_t start;
+	size_t offset;
+
+	uint32_t skip, count, nbr_runs = 0;
+
+	const OIIO::ImageSpec &spec = buf->spec();
+
+	const size_t pixel_bytes = spec.pixel_bytes();
+	const uint8_t *pixels = (const uint8_t *) buf->localpixels();
+
+	auto transparent = [&](size_t i) {
+		const uint8_t *p = pixels + i * pixel_bytes;
+
+		for (size_t j=0; j<pixel_bytes; j++) {
+			if (p[j] != 0)
+				return false;
+		}
+
+		return true;
+	};
+
+	auto append = [&](uint32_t value) {
+		data.insert(data.end(), (const uint8_t *) &value, (const uint8_t *) &value + sizeof(value));
+	};
+
+	n = (size_t) spec.width * spec.height;
+
+	// Header
+	data.insert(data.end(), OVERLAYCACHE_MAGIC, OVERLAYCACHE_MAGIC + 4);
+	append(OVERLAYCACHE_VERSION);
+	append(spec.width);
+	append(spec.height);
+	append(pixel_bytes);
+
+	offset = data.size();
+	append(0);
+
+	// Runs
+	for (i=0; i<n; ) {
+		for (start=i; (i<n) && transparent(i); i++);
+		skip = i - start;
+
+		for (start=i; (i<n) && !transparent(i); i++);
+		count = i - start;
+
+		append(skip);
+		append(count);
+		data.insert(data.end(), pixels + start * pixel_bytes, pixels + i * pixel_bytes);
+
+		nbr_runs++;
+	}
+
+	memcpy(data.data() + offset, &nbr_runs, sizeof(nbr_runs));
+}
+
+
+bool OverlayCache::decode(const std::vector<uint8_t> &data, OIIO::ImageBuf *buf) {
+	size_t n, i;
+	size_t pos = 0;
+
+	uint32_t r, nbr_runs;
+	uint32_t header[5];
+	uint32_t skip, count;
+
+	const OIIO::ImageSpec &spec = buf->spec();
+
+	const size_t pixel_bytes = spec.pixel_bytes();
+	uint8_t *pixels = (uint8_t *) buf->localpixels();
+
+	auto read = [&](void *value, size_t size) {
+		if (pos + size > data.size())
+			return false;
+
+		memcpy(value, data.data() + pos, size);
+		pos += size;
+
+		return true;
+	};
+
+	n = (size_t) spec.width * spec.height;
+
+	// Header has to match layer buffer
+	if ((data.size() < 4) || memcmp(data.data(), OVERLAYCACHE_MAGIC, 4))
+		return false;
+
+	pos = 4;
+
+	if (!read(header, sizeof(header)))
+		return false;
+
+	if ((header[0] != OVERLAYCACHE_VERSION)
+			|| (header[1] != (uint32_t) spec.width) || (header[2] != (uint32_t) spec.height)
+			|| (header[3] != pixel_bytes))
+		return false;
+
+	nbr_runs = header[4];
+
+	memset(pixels, 0, n * pixel_bytes);
+
+	// Runs
+	for (i=0, r=0; r<nbr_runs; r++) {
+		if (!read(&skip, sizeof(skip)) || !read(&count, sizeof(count)))
+			return false;
+
+		i += skip;
+
+		if (i + count > n)
+			return false;
+
+		if (!read(pixels + i * pixel_bytes, count * pixel_bytes))
+			return false;
+
+		i += count;
+	}
+
+	return true;
+}
+
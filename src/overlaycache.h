@@ -0,0 +1,62 @@
+#ifndef __GPX2VIDEO__OVERLAYCACHE_H__
+#define __GPX2VIDEO__OVERLAYCACHE_H__
+
+#include <string>
+#include <vector>
+
+#include <OpenImageIO/imagebuf.h>
+
+#include "gpx.h"
+#include "utils.h"
+
+// Layer file format
+#define OVERLAYCACHE_MAGIC "G2VL"
+#define OVERLAYCACHE_VERSION 1
+
+// Cache size limit, least recently used layers are evicted above
+#define OVERLAYCACHE_MAX_SIZE (1024ULL * 1024 * 1024)
+
+
+/**
+ * On-disk cache of rendered widget layers.
+ * A layer is addressed by the hash of what it's rendered from (layout, GPX,
+ * widget & telemetry sample) and stored as runs of transparent / opaque pixels.
+ */
+class OverlayCache {
+public:
+	virtual ~OverlayCache();
+
+	static OverlayCache * create(void);
+
+	static uint64_t hashSample(const GPXData &data, const time_t &time, uint64_t seed=HASH_SEED);
+
+	bool load(uint64_t key, OIIO::ImageBuf *buf);
+	bool save(uint64_t key, const OIIO::ImageBuf *buf);
+
+	void evict(uint64_t max_size=OVERLAYCACHE_MAX_SIZE);
+
+	const unsigned int& hits(void) const {
+		return hits_;
+	}
+
+	const unsigned int& misses(void) const {
+		return misses_;
+	}
+
+private:
+	OverlayCache();
+
+	void init(void);
+
+	std::string filename(uint64_t key, bool create=false);
+
+	static void encode(const OIIO::ImageBuf *buf, std::vector<uint8_t> &data);
+	static bool decode(const std::vector<uint8_t> &data, OIIO::ImageBuf *buf);
+
+	std::string path_;
+
+	unsigned int hits_;
+	unsigned int misses_;
+};
+
+#endif
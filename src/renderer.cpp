@@ -1,5 +1,15 @@
 #include <iostream>
+#include <fstream>
 #include <memory>
+#include <sstream>
+#include <vector>
+
+#include <stdio.h>
+#include <sys/stat.h>
+
+extern "C" {
+#include <libavutil/time.h>
+}
 
 #include <OpenImageIO/imageio.h>
 #include <OpenImageIO/imagebuf.h>
@@ -31,24 +41,196 @@
 #include "renderer.h"
 
 
+RendererSettings::RendererSettings() {
+	width_ = 0;
+	height_ = 0;
+	bitrate_ = 0;
+}
+
+
+RendererSettings::~RendererSettings() {
+}
+
+
+const std::string& RendererSettings::layoutfile(void) const {
+	return layout_file_;
+}
+
+
+void RendererSettings::setLayoutfile(const std::string &layoutfile) {
+	layout_file_ = layoutfile;
+}
+
+
+const std::string& RendererSettings::outputfile(void) const {
+	return output_file_;
+}
+
+
+void RendererSettings::setOutputfile(const std::string &outputfile) {
+	output_file_ = outputfile;
+}
+
+
+const int& RendererSettings::width(void) const {
+	return width_;
+}
+
+
+const int& RendererSettings::height(void) const {
+	return height_;
+}
+
+
+void RendererSettings::setSize(const int &width, const int &height) {
+	width_ = width;
+	height_ = height;
+}
+
+
+const int& RendererSettings::bitrate(void) const {
+	return bitrate_;
+}
+
+
+void RendererSettings::setBitrate(const int &bitrate) {
+	bitrate_ = bitrate;
+}
+
+
+const std::string& RendererSettings::preset(void) const {
+	return preset_;
+}
+
+
+void RendererSettings::setPreset(const std::string &preset) {
+	preset_ = preset;
+}
+
+
+bool RendererSettings::parse(const std::string &s, RendererSettings &settings) {
+	int width, height;
+
+	std::string field;
+	std::vector<std::string> fields;
+
+	std::istringstream stream(s);
+
+	// file,layout,WxH[,kbps[,preset]]
+	while (std::getline(stream, field, ','))
+		fields.push_back(field);
+
+	if ((fields.size() < 3) || (fields.size() > 5))
+		return false;
+
+	if (fields[0].empty())
+		return false;
+
+	if (sscanf(fields[2].c_str(), "%dx%d", &width, &height) != 2)
+		return false;
+
+	// 4:2:0 chroma needs even sizes
+	if ((width <= 0) || (height <= 0) || (width % 2) || (height % 2))
+		return false;
+
+	settings.setOutputfile(fields[0]);
+	settings.setLayoutfile(fields[1]);
+	settings.setSize(width, height);
+
+	if (fields.size() > 3)
+		settings.setBitrate(atoi(fields[3].c_str()));
+
+	if (fields.size() > 4)
+		settings.setPreset(fields[4]);
+
+	return true;
+}
+
+
+Renderer::Output::Output(const RendererSettings &settings)
+	: settings_(settings) {
+	width_ = 0;
+	height_ = 0;
+
+	encoder_ = NULL;
+
+	overlay_ = NULL;
+	compositor_ = NULL;
+}
+
+
+Renderer::Output::~Output() {
+	if (compositor_)
+		delete compositor_;
+	if (overlay_)
+		delete overlay_;
+	if (encoder_)
+		delete encoder_;
+}
+
+
+const RendererSettings& Renderer::Output::settings(void) const {
+	return settings_;
+}
+
+
+const int& Renderer::Output::width(void) const {
+	return width_;
+}
+
+
+const int& Renderer::Output::height(void) const {
+	return height_;
+}
+
+
+std::string Renderer::Output::filename(void) const {
+	return settings_.outputfile();
+}
+
+
 Renderer::Renderer(GPX2Video &app)
 	: Task(app) 
 	, app_(app) {
 	container_ = NULL;
 	decoder_audio_ = NULL;
 	decoder_video_ = NULL;
-	encoder_ = NULL;
 
-	overlay_ = NULL;
+	audio_ = NULL;
+
+	overlay_cache_ = NULL;
+	sample_ = 0;
 
 	frame_time_ = 0;
 	duration_ms_ = 0;
+
+	finished_ = false;
+	segment_ = 0;
+	segment_frame_ = 0;
+	resume_pts_ = AV_NOPTS_VALUE;
+	resume_timecode_ms_ = 0;
+
+	refresh_ = true;
+	live_origin_ = AV_NOPTS_VALUE;
+	live_origin_pts_ = 0;
+	live_frames_ = 0;
+	live_degraded_ = 0;
+	live_dropped_ = 0;
+	live_latency_sum_ = 0;
+	live_latency_max_ = 0;
 }
 
 
 Renderer::~Renderer() {
-	if (encoder_)
-		delete encoder_;
+	for (Output *output : outputs_)
+		delete output;
+
+	outputs_.clear();
+
+	if (audio_)
+		delete audio_;
+	if (overlay_cache_)
+		delete overlay_cache_;
 	if (decoder_audio_)
 		delete decoder_audio_;
 	if (decoder_video_)
@@ -60,8 +242,12 @@ Renderer * Renderer::create(GPX2Video &app) {
 	Renderer *renderer = new Renderer(app);
 
 	renderer->init();
-	renderer->load();
-	renderer->computeWidgetsPosition();
+
+	// Each output has its own layout
+	for (Output *output : renderer->outputs_) {
+		renderer->load(output);
+		renderer->computeWidgetsPosition(output);
+	}
 
 	return renderer;
 }
@@ -77,6 +263,10 @@ void Renderer::init(void) {
 	// Media
 	container_ = app_.media();
 
+	// Live input without creation time, media starts now
+	if ((app_.settings().live() > 0) && (container_->startTime() == 0))
+		container_->setStartTime(time(NULL));
+
 	// Set start time in GPX stream
 	start_time = container_->startTime() + container_->timeOffset();
 	if (gpx_) {
@@ -94,30 +284,35 @@ void Renderer::init(void) {
 	VideoStreamPtr video_stream = container_->getVideoStream();
 	AudioStreamPtr audio_stream = container_->getAudioStream();
 
-	// Audio & Video encoder settings
-	VideoParams video_params(video_stream->width(), video_stream->height(),
-		// av_make_q(1,  50), 
-		av_inv_q(video_stream->frameRate()),
-		video_stream->format(),
-		video_stream->nbChannels(),
-		video_stream->pixelAspectRatio(),
-		video_stream->interlacing());
-	video_params.setPixelFormat(video_stream->pixelFormat());
-
-	EncoderSettings settings;
-	settings.setFilename(app_.settings().outputfile());
-	settings.setVideoParams(video_params, AV_CODEC_ID_H264);
-	settings.setVideoBitrate(4 * 1000 * 1000 * 8);
-	settings.setVideoMaxBitrate(2 * 1000 * 1000 * 16);
-	settings.setVideoBufferSize(4 * 1000 * 1000 / 2);
+	// Timelapse mode drops audio track
+	if (app_.settings().timelapse() > 1)
+		audio_stream = nullptr;
 
-	if (audio_stream) {
-		AudioParams audio_params(audio_stream->sampleRate(),
-			audio_stream->channelLayout(),
-			audio_stream->format());
+	// Live mode drops audio track too (each decoder opens its own input, a live input can't be read twice)
+	if (app_.settings().live() > 0)
+		audio_stream = nullptr;
+
+	// Outputs, main layout & output first then each rendition
+	{
+		RendererSettings settings;
+
+		settings.setLayoutfile(app_.settings().layoutfile());
+		settings.setOutputfile(app_.settings().outputfile());
 
-		settings.setAudioParams(audio_params, AV_CODEC_ID_AAC);
-		settings.setAudioBitrate(44 * 1000);
+		outputs_.push_back(new Output(settings));
+	}
+
+	for (const RendererSettings &settings : app_.settings().renditions())
+		outputs_.push_back(new Output(settings));
+
+	// Resumable render, output is split in closed segments
+	if (app_.settings().checkpoint() > 0)
+		loadCheckpoint();
+
+	// Trim, start rendering at trim offset
+	if ((resume_pts_ == AV_NOPTS_VALUE) && (app_.settings().trim() > 0)) {
+		resume_timecode_ms_ = app_.settings().trim();
+		resume_pts_ = av_rescale_q(resume_timecode_ms_, av_make_q(1, 1000), video_stream->timeBase());
 	}
 
 	// Compute duration
@@ -128,22 +323,105 @@ void Renderer::init(void) {
 		(unsigned int) (duration_ms_ / 3600000), (unsigned int) ((duration_ms_ / 60000) % 60), (unsigned int) ((duration_ms_ / 1000) % 60), (unsigned int) (duration_ms_ % 1000));
 	duration_[sizeof(duration_) - 1] = '\0';
 
-	// Open & decode input media
+	// Open & decode input media (decoded once for all outputs)
 	decoder_video_ = Decoder::create();
+	decoder_video_->setLowDelay(app_.settings().live() > 0);
 	decoder_video_->open(video_stream);
 
+	// Timelapse mode, decode only the frames we need
+	if (app_.settings().timelapse() > 1) {
+		log_info("Timelapse mode, keep 1 frame every %d", app_.settings().timelapse());
+
+		decoder_video_->setFrameDrop(true);
+
+		// Keyframes are enough when the step covers the longest GOP (measured, as
+		// GOPs of 2-4 s are common once re-encoded)
+		int64_t gop = decoder_video_->keyFrameInterval();
+
+		if ((gop > 0)
+			&& ((app_.settings().timelapse() / av_q2d(video_stream->frameRate())) >= (gop * av_q2d(video_stream->timeBase())))) {
+			log_info("Timelapse mode, decode keyframes only");
+
+			decoder_video_->setKeyFrameOnly(true);
+		}
+	}
+
 	if (audio_stream) {
 		decoder_audio_ = Decoder::create();
 		decoder_audio_->open(audio_stream);
 	}
 
-	// Open & encode output video
-	encoder_ = Encoder::create(settings);
-	encoder_->open();
+	// Resume from checkpoint or trim offset (seek to the preceding keyframe)
+	if (resume_pts_ != AV_NOPTS_VALUE) {
+		log_notice("Start rendering at %ld ms (segment %d)", resume_timecode_ms_, segment_);
+
+		decoder_video_->seek(resume_pts_);
+
+		if (decoder_audio_)
+			decoder_audio_->seek(av_rescale_q(resume_pts_, video_stream->timeBase(), audio_stream->timeBase()));
+	}
+
+	// Open & encode each output video
+	for (Output *output : outputs_) {
+		int64_t bitrate;
+
+		const RendererSettings &rendition = output->settings();
+
+		// Output size (source size by default)
+		output->width_ = (rendition.width() > 0) ? rendition.width() : video_stream->width();
+		output->height_ = (rendition.height() > 0) ? rendition.height() : video_stream->height();
+
+		// Audio & Video encoder settings
+		VideoParams video_params(output->width_, output->height_,
+			// av_make_q(1,  50), 
+			av_inv_q(video_stream->frameRate()),
+			video_stream->format(),
+			video_stream->nbChannels(),
+			video_stream->pixelAspectRatio(),
+			video_stream->interlacing());
+		video_params.setPixelFormat(video_stream->pixelFormat());
+
+		// Default bitrate: 32 Mbps
+		bitrate = (rendition.bitrate() > 0) ? (int64_t) rendition.bitrate() * 1000 : 4 * 1000 * 1000 * 8;
+
+		EncoderSettings settings;
+		settings.setFilename(output->filename());
+		settings.setVideoParams(video_params, AV_CODEC_ID_H264);
+		settings.setVideoBitrate(bitrate);
+		settings.setVideoMaxBitrate(bitrate);
+		settings.setVideoBufferSize(bitrate / 16);
+		settings.setVideoPreset(rendition.preset());
+		settings.setLowDelay(app_.settings().live() > 0);
+
+		if (app_.settings().checkpoint() > 0)
+			settings.setFilename(segmentFilename(output, segment_));
+
+		if (audio_stream) {
+			AudioParams audio_params(audio_stream->sampleRate(),
+				audio_stream->channelLayout(),
+				audio_stream->format());
+
+			settings.setAudioParams(audio_params, AV_CODEC_ID_AAC);
+			settings.setAudioBitrate(44 * 1000);
+		}
+
+		log_info("Output '%s' %dx%d", output->filename().c_str(), output->width_, output->height_);
+
+		output->encoder_ = Encoder::create(settings);
+		output->encoder_->open();
+	}
+
+	// Audio is decoded, resampled & encoded on its own thread
+	if (decoder_audio_) {
+		audio_ = AudioPipeline::create(decoder_audio_, outputs_.front()->encoder_->settings().audioParams(), audio_stream->timeBase());
+
+		for (Output *output : outputs_)
+			audio_->append(output->encoder_);
+	}
 }
 
 
-bool Renderer::load(void) {
+bool Renderer::load(Output *output) {
 	std::ifstream stream;
 
 	layout::Layout *root;
@@ -154,7 +432,7 @@ bool Renderer::load(void) {
 	std::list<layout::Track *> tracks;
 	std::list<layout::Widget *> widgets;
 
-	std::string filename = app_.settings().layoutfile();
+	std::string filename = output->settings().layoutfile();
 
 	if (filename.empty()) {
 		log_warn("None layout file");
@@ -180,7 +458,7 @@ bool Renderer::load(void) {
 	std::cout << "Parsing '" << filename << "' layout file" << std::endl;
 
 	// Widgets
-	widgets = root->widgets().list();
+	widgets.assign(root->widgets().list().begin(), root->widgets().list().end());
 
 	for (std::list<layout::Widget *>::iterator node = widgets.begin(); node != widgets.end(); ++node) {
 		layout::Widget *widget = (*node);
@@ -194,11 +472,11 @@ bool Renderer::load(void) {
 			continue;
 		}
 
-		loadWidget(widget);
+		loadWidget(output, widget);
 	}
 
 	// Tracks
-	tracks = root->tracks().list();
+	tracks.assign(root->tracks().list().begin(), root->tracks().list().end());
 
 	for (std::list<layout::Track *>::iterator node = tracks.begin(); node != tracks.end(); ++node) {
 		layout::Track *track = (*node);
@@ -212,11 +490,11 @@ bool Renderer::load(void) {
 			continue;
 		}
 
-		loadTrack(track);
+		loadTrack(output, track);
 	}
 
 	// Maps
-	maps = root->maps().list();
+	maps.assign(root->maps().list().begin(), root->maps().list().end());
 
 	for (std::list<layout::Map *>::iterator node = maps.begin(); node != maps.end(); ++node) {
 		layout::Map *map = (*node);
@@ -230,7 +508,7 @@ bool Renderer::load(void) {
 			continue;
 		}
 
-		loadMap(map);
+		loadMap(output, map);
 	}
 
 done:
@@ -241,7 +519,7 @@ failure:
 }
 
 
-bool Renderer::loadMap(layout::Map *m) {
+bool Renderer::loadMap(Output *output, layout::Map *m) {
 	int x, y;
 	int width, height;
 
@@ -275,25 +553,20 @@ bool Renderer::loadMap(layout::Map *m) {
 	gpx->setFrom(app_.settings().gpxFrom());
 	gpx->setTo(app_.settings().gpxTo());
 
-	// Media
-	MediaContainer *container = app_.media();
-
-	VideoStreamPtr video_stream = container->getVideoStream();
-
 	// Default size
 	//   2704x1520 => 800x500
 	//   1920x1080 =>   ?x?
-	width = (m->width() > 0) ? m->width() : 800 * video_stream->width() / 2704;
-	height = (m->height() > 0) ? m->height() : 500 * video_stream->height() / 1520;
+	width = (m->width() > 0) ? m->width() : 800 * output->width() / 2704;
+	height = (m->height() > 0) ? m->height() : 500 * output->height() / 1520;
 
 	// Default position
-	x = (m->x() > 0) ? m->x() : video_stream->width() - width - m->margin();
-	y = (m->y() > 0) ? m->y() : video_stream->height() - height - m->margin();
+	x = (m->x() > 0) ? m->x() : output->width() - width - m->margin();
+	y = (m->y() > 0) ? m->y() : output->height() - height - m->margin();
 
 	// Default marker size (132x200)
 	// 2704x1520 => 40x60
 	//  432x240  =>  ?x?
-	marker_size = (m->marker() > 0) ? m->marker() : 60 * video_stream->height() / 1520.0;
+	marker_size = (m->marker() > 0) ? m->marker() : 60 * output->height() / 1520.0;
 
 	// Create map bounding box
 	GPXData::point p1, p2;
@@ -335,13 +608,13 @@ bool Renderer::loadMap(layout::Map *m) {
 	// Append
 	app_.append(map);
 
-	this->append(map);
+	this->append(output, map);
 
 	return true;
 }
 
 
-bool Renderer::loadTrack(layout::Track *t) {
+bool Renderer::loadTrack(Output *output, layout::Track *t) {
 	int x, y;
 	int width, height;
 
@@ -363,20 +636,15 @@ bool Renderer::loadTrack(layout::Track *t) {
 	gpx->setFrom(app_.settings().gpxFrom());
 	gpx->setTo(app_.settings().gpxTo());
 
-	// Media
-	MediaContainer *container = app_.media();
-
-	VideoStreamPtr video_stream = container->getVideoStream();
-
 	// Default size
 	//   2704x1520 => 800x500
 	//   1920x1080 => 560x350
-	width = (t->width() > 0) ? t->width() : 800 * video_stream->width() / 2704;
-	height = (t->height() > 0) ? t->height() : 500 * video_stream->height() / 1520;
+	width = (t->width() > 0) ? t->width() : 800 * output->width() / 2704;
+	height = (t->height() > 0) ? t->height() : 500 * output->height() / 1520;
 
 	// Default position
-	x = (t->x() > 0) ? t->x() : video_stream->width() - width - t->margin();
-	y = (t->y() > 0) ? t->y() : video_stream->height() - height - t->margin();
+	x = (t->x() > 0) ? t->x() : output->width() - width - t->margin();
+	y = (t->y() > 0) ? t->y() : output->height() - height - t->margin();
 
 	// Create map bounding box
 	GPXData::point p1, p2;
@@ -413,13 +681,13 @@ bool Renderer::loadTrack(layout::Track *t) {
 	// Append
 	app_.append(track);
 
-	this->append(track);
+	this->append(output, track);
 
 	return true;
 }
 
 
-bool Renderer::loadWidget(layout::Widget *w) {
+bool Renderer::loadWidget(Output *output, layout::Widget *w) {
 	std::string s;
 
 	VideoWidget *widget = NULL;
@@ -519,7 +787,7 @@ bool Renderer::loadWidget(layout::Widget *w) {
 	// Append
 	app_.append(widget);
 
-	this->append(widget);
+	this->append(output, widget);
 
 	return true;
 
@@ -531,14 +799,17 @@ error:
 }
 
 
-void Renderer::append(VideoWidget *widget) {
+void Renderer::append(Output *output, VideoWidget *widget) {
 	log_info("Initialize %s widget", widget->name().c_str());
 
-	widgets_.push_back(widget);
+	output->widgets_.push_back(widget);
+
+	// Widget (map...) has to be ready before rendering
+	addDependency(widget);
 }
 
 
-void Renderer::computeWidgetsPosition(void) {
+void Renderer::computeWidgetsPosition(Output *output) {
 	int n;
 	int width, height;
 
@@ -548,13 +819,11 @@ void Renderer::computeWidgetsPosition(void) {
 	int margintop, marginbottom;
 	int marginleft, marginright;
 
-	VideoStreamPtr video_stream = container_->getVideoStream();
-
 	// TopLeft, TopRight, BottomLeft, BottomRight
 	//-----------------------------------------------------------
 
 	// Get align position (left, top, bottom, right)
-	for (VideoWidget *widget : widgets_) {
+	for (VideoWidget *widget : output->widgets_) {
 		switch (widget->align()) {
 		case VideoWidget::AlignTopLeft:
 			x = widget->margin(VideoWidget::MarginLeft);
@@ -562,18 +831,18 @@ void Renderer::computeWidgetsPosition(void) {
 			break;
 
 		case VideoWidget::AlignTopRight:
-			x = video_stream->width() - widget->margin(VideoWidget::MarginRight) - widget->width();
+			x = output->width() - widget->margin(VideoWidget::MarginRight) - widget->width();
 			y = widget->margin(VideoWidget::MarginTop);
 			break;
 
 		case VideoWidget::AlignBottomLeft:
 			x = widget->margin(VideoWidget::MarginLeft);
-			y = video_stream->height() - widget->margin(VideoWidget::MarginBottom) - widget->height();
+			y = output->height() - widget->margin(VideoWidget::MarginBottom) - widget->height();
 			break;
 
 		case VideoWidget::AlignBottomRight:
-			x = video_stream->width() - widget->margin(VideoWidget::MarginRight) - widget->width();
-			y = video_stream->height() - widget->margin(VideoWidget::MarginBottom) - widget->height();
+			x = output->width() - widget->margin(VideoWidget::MarginRight) - widget->width();
+			y = output->height() - widget->margin(VideoWidget::MarginBottom) - widget->height();
 			break;
 
 		default:
@@ -591,7 +860,7 @@ void Renderer::computeWidgetsPosition(void) {
 	marginbottom = 0;
 
 	// Get align position (left, top, bottom, right)
-	for (VideoWidget *widget : widgets_) {
+	for (VideoWidget *widget : output->widgets_) {
 		if (widget->align() == VideoWidget::AlignTopLeft) {
 			margintop = MAX(widget->height() + widget->margin(VideoWidget::MarginTop) + widget->margin(VideoWidget::MarginBottom), margintop);
 			continue;
@@ -612,12 +881,12 @@ void Renderer::computeWidgetsPosition(void) {
 	}
 
 	// Compute position for each widget
-	space = video_stream->height() - (height + margintop + marginbottom);
+	space = output->height() - (height + margintop + marginbottom);
 	space = MAX(0, space);
 
 	// Set position (for 'left' align)
 	offset = space / 2;
-	for (VideoWidget *widget : widgets_) {
+	for (VideoWidget *widget : output->widgets_) {
 		if (widget->align() != VideoWidget::AlignLeft)
 			continue;
 
@@ -639,7 +908,7 @@ void Renderer::computeWidgetsPosition(void) {
 	marginbottom = 0;
 
 	// Get align position (left, top, bottom, right)
-	for (VideoWidget *widget : widgets_) {
+	for (VideoWidget *widget : output->widgets_) {
 		if (widget->align() == VideoWidget::AlignTopRight) {
 			margintop = MAX(widget->height() + widget->margin(VideoWidget::MarginTop) + widget->margin(VideoWidget::MarginBottom), margintop);
 			continue;
@@ -660,16 +929,16 @@ void Renderer::computeWidgetsPosition(void) {
 	}
 
 	// Compute position for each widget
-	space = video_stream->height() - (height + margintop + marginbottom);
+	space = output->height() - (height + margintop + marginbottom);
 	space = MAX(0, space);
 
 	// Set position (for 'right' align)
 	offset = space / 2;
-	for (VideoWidget *widget : widgets_) {
+	for (VideoWidget *widget : output->widgets_) {
 		if (widget->align() != VideoWidget::AlignRight)
 			continue;
 
-		x = video_stream->width() - widget->margin(VideoWidget::MarginRight) - widget->width();
+		x = output->width() - widget->margin(VideoWidget::MarginRight) - widget->width();
 		y = margintop + offset + widget->margin(VideoWidget::MarginTop);
 
 		widget->setPosition(x, y);
@@ -687,7 +956,7 @@ void Renderer::computeWidgetsPosition(void) {
 	marginright = 0;
 
 	// Get align position (left, top, bottom, right)
-	for (VideoWidget *widget : widgets_) {
+	for (VideoWidget *widget : output->widgets_) {
 		if (widget->align() == VideoWidget::AlignTopLeft) {
 			marginleft = MAX(widget->width() + widget->margin(VideoWidget::MarginLeft) + widget->margin(VideoWidget::MarginRight), marginleft);
 			continue;
@@ -708,12 +977,12 @@ void Renderer::computeWidgetsPosition(void) {
 	}
 
 	// Compute position for each widget
-	space = video_stream->width() - (width + marginleft + marginright);
+	space = output->width() - (width + marginleft + marginright);
 	space = MAX(0, space);
 
 	// Set position (for 'top' align)
 	offset = space / 2;
-	for (VideoWidget *widget : widgets_) {
+	for (VideoWidget *widget : output->widgets_) {
 		if (widget->align() != VideoWidget::AlignTop)
 			continue;
 
@@ -735,7 +1004,7 @@ void Renderer::computeWidgetsPosition(void) {
 	marginright = 0;
 
 	// Get align position (left, top, bottom, right)
-	for (VideoWidget *widget : widgets_) {
+	for (VideoWidget *widget : output->widgets_) {
 		if (widget->align() == VideoWidget::AlignBottomLeft) {
 			marginleft = MAX(widget->width() + widget->margin(VideoWidget::MarginLeft) + widget->margin(VideoWidget::MarginRight), marginleft);
 			continue;
@@ -756,17 +1025,17 @@ void Renderer::computeWidgetsPosition(void) {
 	}
 
 	// Compute position for each widget
-	space = video_stream->width() - (width + marginleft + marginright);
+	space = output->width() - (width + marginleft + marginright);
 	space = MAX(0, space);
 
 	// Set position (for 'bottom' align)
 	offset = space / 2;
-	for (VideoWidget *widget : widgets_) {
+	for (VideoWidget *widget : output->widgets_) {
 		if (widget->align() != VideoWidget::AlignBottom)
 			continue;
 
 		x = marginleft + offset + widget->margin(VideoWidget::MarginLeft);
-		y = video_stream->height() - widget->margin(VideoWidget::MarginBottom) - widget->height();
+		y = output->height() - widget->margin(VideoWidget::MarginBottom) - widget->height();
 
 		widget->setPosition(x, y);
 
@@ -782,6 +1051,8 @@ bool Renderer::start(void) {
 
 	time_t start_time;
 
+	uint64_t gpx_key = 0;
+
 	VideoStreamPtr video_stream = container_->getVideoStream();
 
 	log_call();
@@ -795,17 +1066,67 @@ bool Renderer::start(void) {
 	if (gpx_) {
 		gpx_->setStartTime(start_time);
 //		data_.init();
+
+		// Resume from checkpoint or trim offset, replay GPX data up to there
+		if (resume_pts_ != AV_NOPTS_VALUE)
+			gpx_->retrieveNext(data_, resume_timecode_ms_);
 	}
 
 	started_at_ = now;
 
-	// Create overlay buffer
-	overlay_ = new OIIO::ImageBuf(OIIO::ImageSpec(video_stream->width(), video_stream->height(), 
-		video_stream->nbChannels(), OIIOUtils::getOIIOBaseTypeFromFormat(video_stream->format())));
+	// Persistent layers cache
+	if (app_.settings().overlayCache())
+		overlay_cache_ = OverlayCache::create();
 
-	// Prepare each widget, map...
-	for (VideoWidget *widget : widgets_)
-		widget->prepare(overlay_);
+	// Input files are hashed only to name persistent layers (it reads the whole GPX)
+	if (overlay_cache_)
+		gpx_key = hashFile(app_.settings().gpxfile());
+
+	for (Output *output : outputs_) {
+		uint64_t key;
+
+		int i = 0;
+
+		// Create overlay buffer
+		output->overlay_ = new OIIO::ImageBuf(OIIO::ImageSpec(output->width(), output->height(), 
+			video_stream->nbChannels(), OIIOUtils::getOIIOBaseTypeFromFormat(video_stream->format())));
+
+		// Prepare each widget, map...
+		for (VideoWidget *widget : output->widgets_)
+			widget->prepare(output->overlay_);
+
+		// Compile draw list, static parts first then a dynamic layer per widget
+		output->compositor_ = Compositor::create(output->overlay_->spec());
+
+		for (VideoWidget *widget : output->widgets_) {
+			OIIO::ROI rect(widget->x(), widget->x() + widget->width(), widget->y(), widget->y() + widget->height());
+
+			output->compositor_->append(0, rect, Compositor::BlendOver, output->overlay_);
+		}
+
+		for (VideoWidget *widget : output->widgets_) {
+			OIIO::ROI rect(widget->x(), widget->x() + widget->width(), widget->y(), widget->y() + widget->height());
+
+			output->layers_.push_back(output->compositor_->append(1, rect, Compositor::BlendOver));
+		}
+
+		// Layer keys: layout, GPX, layer format then widget
+		key = overlay_cache_ ? hashFile(output->settings().layoutfile(), gpx_key) : gpx_key;
+		key = hashData(&output->overlay_->spec().nchannels, sizeof(int), key);
+		key = hashData(&output->overlay_->spec().format.basetype, sizeof(output->overlay_->spec().format.basetype), key);
+
+		for (VideoWidget *widget : output->widgets_) {
+			const int geometry[] = { i++, widget->x(), widget->y(), widget->width(), widget->height() };
+
+			output->keys_.push_back(hashData(widget->name(), hashData(geometry, sizeof(geometry), key)));
+			output->contents_.push_back(0);
+		}
+
+		output->compositor_->compile();
+	}
+
+	if (audio_)
+		audio_->start();
 
 	return true;
 }
@@ -826,18 +1147,11 @@ bool Renderer::run(void) {
 
 	start_time = container_->startTime() + container_->timeOffset();
 
-	real_time = av_mul_q(av_make_q(frame_time_, 1), encoder_->settings().videoParams().timeBase());
+	real_time = av_mul_q(av_make_q(frame_time_, 1), outputs_.front()->encoder_->settings().videoParams().timeBase());
 
-	// Read audio data
-	if (decoder_audio_) {
-		frame = decoder_audio_->retrieveAudio(encoder_->settings().audioParams(), real_time);
-
-		if (frame != NULL)
-			encoder_->writeAudio(frame, real_time);
-	}
-
-	// Read video data
-	frame = decoder_video_->retrieveVideo(real_time);
+	// Read video data (in timelapse mode, skip frames up to the next step)
+	frame = decoder_video_->retrieveVideo(av_add_q(av_make_q(app_.settings().trim(), 1000),
+		av_mul_q(real_time, av_make_q(app_.settings().timelapse(), 1))));
 
 	if (frame == NULL)
 		goto done;
@@ -848,17 +1162,46 @@ bool Renderer::run(void) {
 	// Compute video time
 	app_.setTime(start_time + (timecode_ms / 1000));
 
+	// Live mode, a late frame is degraded (widgets aren't refreshed) or dropped rather than queued
+	refresh_ = true;
+
+	if (app_.settings().live() > 0) {
+		switch (pace(timecode)) {
+		case PaceDrop:
+			live_dropped_++;
+			goto skip;
+
+		case PaceLate:
+			live_degraded_++;
+			refresh_ = false;
+			break;
+
+		case PaceOnTime:
+		default:
+			break;
+		}
+	}
+
+	// Resumable render, segment is done (next one starts on a keyframe)
+	if ((app_.settings().checkpoint() > 0) && (frame_time_ > segment_frame_)) {
+		if ((frame_time_ - segment_frame_) >= app_.settings().checkpoint() * av_q2d(video_stream->frameRate())) {
+			if (!nextSegment(timecode, timecode_ms)) {
+				log_error("Next segment failure, rendering stopped (it can be resumed)");
+				goto failure;
+			}
+		}
+	}
+
+	// Read GPX data (each GPX point up to timecode is computed, so aggregated values are kept)
 	if (gpx_) {
-		// Read GPX data
 		gpx_->retrieveNext(data_, timecode_ms);
 
-		// Draw
-		this->draw(frame, data_);
+		sample_ = OverlayCache::hashSample(data_, app_.time());
 	}
 
 	// Max rendering duration
 	if (app_.settings().maxDuration() > 0) {
-		if (timecode_ms > app_.settings().maxDuration())
+		if ((timecode_ms - app_.settings().trim()) > app_.settings().maxDuration())
 			goto done;
 	}
 
@@ -877,9 +1220,20 @@ bool Renderer::run(void) {
 			printf("FRAME: %ld - PTS: %ld - TIMESTAMP: %ld ms - TIME: %s\n", 
 				frame_time_, timecode, timecode_ms, s);
 		}
+		else if (app_.settings().live() > 0) {
+			int64_t average_ms = (live_frames_ > 0) ? live_latency_sum_ / live_frames_ / 1000 : 0;
+
+			printf("\r[FRAME %5ld] %02d:%02d:%02d.%03d | Latency: %4ld ms (max: %4ld ms) - Late: %ld - Dropped: %ld", 
+				frame_time_, 
+				(int) (timecode_ms / 3600000), (int) ((timecode_ms / 60000) % 60), (int) ((timecode_ms / 1000) % 60), (int) (timecode_ms % 1000),
+				average_ms, live_latency_max_ / 1000,
+				live_degraded_, live_dropped_);
+			fflush(stdout);
+		}
 		else {
 			int percent = 100 * timecode_ms / duration_ms_;
-			int remaining = (timecode_ms > 0) ? (now - started_at_) * (duration_ms_ - timecode_ms) / timecode_ms : -1;
+			int64_t rendered_ms = timecode_ms - resume_timecode_ms_;
+			int remaining = (rendered_ms > 0) ? (now - started_at_) * (duration_ms_ - timecode_ms) / rendered_ms : -1;
 
 			printf("\r[FRAME %5ld] %02d:%02d:%02d.%03d / %s | %3d%% - Remaining time: %02d:%02d:%02d", 
 				frame_time_, 
@@ -896,10 +1250,33 @@ bool Renderer::run(void) {
 	if (gpx_ && app_.progressInfo())
 		data_.dump();
 
-	real_time = av_mul_q(av_make_q(timecode, 1), video_stream->timeBase());
+	// In timelapse mode, output timestamps are rebased on the frame counter
+	if (app_.settings().timelapse() == 1)
+		real_time = av_mul_q(av_make_q(timecode, 1), video_stream->timeBase());
+
+	// Draw & encode each output from the shared decoded frame (main output
+	// comes last, so it can be drawn in place once renditions are scaled)
+	{
+		OIIO::ImageBuf source = frame->toImageBuf();
+
+		for (std::list<Output *>::reverse_iterator it = outputs_.rbegin(); it != outputs_.rend(); ++it) {
+			Output *output = *it;
+
+			FramePtr result = render(output, frame, source, (output == outputs_.front()));
+
+			output->encoder_->writeFrame(result, real_time);
+		}
+	}
+
+	// Live mode, measure end-to-end latency
+	if (app_.settings().live() > 0)
+		latency(timecode);
 
-	encoder_->writeFrame(frame, real_time);
+	// Audio thread can go on up to the end of this frame
+	if (audio_)
+		audio_->advance(av_add_q(real_time, av_inv_q(video_stream->frameRate())));
 
+skip:
 	frame_time_++;
 
 	schedule();
@@ -907,9 +1284,17 @@ bool Renderer::run(void) {
 	return true;
 
 done:
+	finished_ = true;
+
 	complete();
 
 	return true;
+
+failure:
+	// Not finished: segments & last checkpoint are kept, no merge
+	complete();
+
+	return false;
 }
 
 
@@ -924,42 +1309,450 @@ bool Renderer::stop(void) {
 	// Retrieve audio & video streams
 	VideoStreamPtr video_stream = container_->getVideoStream();
 
+	// Wait for audio up to the last video frame
+	if (audio_)
+		audio_->stop();
+
 	// Sum-up
 	working = now - started_at_;
 
-	printf("%ld frames %dx%d to %dx%d proceed in %02d:%02d:%02d\n",
-		frame_time_,
-		video_stream->width(), video_stream->height(),
-		encoder_->settings().videoParams().width(), encoder_->settings().videoParams().height(),
-		(working / 3600), (working / 60) % 60, (working) % 60);
+	for (Output *output : outputs_) {
+		printf("%ld frames %dx%d to %dx%d proceed in %02d:%02d:%02d (%s)\n",
+			frame_time_,
+			video_stream->width(), video_stream->height(),
+			output->width(), output->height(),
+			(working / 3600), (working / 60) % 60, (working) % 60,
+			output->filename().c_str());
+
+		output->encoder_->close();
+	}
+
+	if (app_.settings().live() > 0) {
+		printf("Live: latency %ld ms (max: %ld ms), %ld frames late, %ld frames dropped\n",
+			(live_frames_ > 0) ? live_latency_sum_ / live_frames_ / 1000 : 0,
+			live_latency_max_ / 1000,
+			live_degraded_, live_dropped_);
+	}
+
+	if (overlay_cache_) {
+		log_info("Overlay cache: %u layers reused, %u rendered", overlay_cache_->hits(), overlay_cache_->misses());
+
+		overlay_cache_->evict();
+	}
 
-	encoder_->close();
 	if (decoder_audio_)
 		decoder_audio_->close();
+
+	// Resumable render, build each output from segments
+	if ((app_.settings().checkpoint() > 0) && finished_)
+		merge();
+
 	decoder_video_->close();
 
-	if (overlay_)
-		delete overlay_;
+	for (Output *output : outputs_) {
+		if (output->compositor_)
+			delete output->compositor_;
+		if (output->overlay_)
+			delete output->overlay_;
+
+		output->compositor_ = NULL;
+		output->overlay_ = NULL;
+
+		output->layers_.clear();
+	}
 
 	decoder_audio_ = NULL;
 	decoder_video_ = NULL;
-	overlay_ = NULL;
 
 	return true;
 }
 
 
-void Renderer::draw(FramePtr frame, const GPXData &data) {
-	OIIO::ImageBuf frame_buffer = frame->toImageBuf();
+std::string Renderer::segmentFilename(Output *output, int segment) {
+	char s[16];
+
+	size_t pos;
+
+	std::string filename = output->filename();
+
+	snprintf(s, sizeof(s), "-%03d", segment);
+
+	// Insert segment number before extension
+	pos = filename.find_last_of("./");
+
+	if ((pos == std::string::npos) || (filename[pos] == '/'))
+		return filename + s;
+
+	return filename.substr(0, pos) + s + filename.substr(pos);
+}
+
+
+std::string Renderer::checkpointFilename(void) {
+	return app_.settings().outputfile() + ".checkpoint";
+}
+
+
+// Path, size & modification time of an input file
+static std::string fileStamp(const std::string &filename) {
+	struct stat st;
+
+	std::ostringstream stamp;
+
+	stamp << filename;
+
+	if (!filename.empty() && (::stat(filename.c_str(), &st) == 0))
+		stamp << "," << st.st_size << "," << st.st_mtime;
+
+	return stamp.str();
+}
+
+
+/**
+ * Every setting the rendered segments depend on. A checkpoint saved with
+ * other settings can't be resumed: its segments wouldn't match the output.
+ */
+std::string Renderer::checkpointSettings(void) {
+	std::ostringstream settings;
+
+	const GPX2Video::Settings &s = app_.settings();
+
+	settings << "gpx=" << fileStamp(s.gpxfile())
+		<< ";layout=" << fileStamp(s.layoutfile())
+		<< ";offset=" << s.offset()
+		<< ";from=" << s.gpxFrom()
+		<< ";to=" << s.gpxTo()
+		<< ";duration=" << s.maxDuration()
+		<< ";filter=" << (int) s.telemetryFilter()
+		<< ";map=" << (int) s.mapsource() << "," << s.mapzoom() << "," << s.mapfactor()
+		<< ";trim=" << s.trim()
+		<< ";timelapse=" << s.timelapse()
+		<< ";checkpoint=" << s.checkpoint();
+
+	for (const RendererSettings &rendition : s.renditions()) {
+		settings << ";rendition=" << fileStamp(rendition.layoutfile())
+			<< "," << rendition.outputfile()
+			<< "," << rendition.width() << "x" << rendition.height()
+			<< "," << rendition.bitrate()
+			<< "," << rendition.preset();
+	}
+
+	return settings.str();
+}
+
+
+bool Renderer::loadCheckpoint(void) {
+	std::string line;
+	std::string media;
+	std::string settings;
+
+	std::ifstream stream(checkpointFilename());
+
+	log_call();
+
+	if (!stream.is_open())
+		return false;
+
+	// key=value lines
+	while (std::getline(stream, line)) {
+		size_t pos = line.find('=');
+
+		if (pos == std::string::npos)
+			continue;
+
+		std::string key = line.substr(0, pos);
+		std::string value = line.substr(pos + 1);
+
+		if (key == "media")
+			media = value;
+		else if (key == "settings")
+			settings = value;
+		else if (key == "segment")
+			segment_ = atoi(value.c_str());
+		else if (key == "frame")
+			frame_time_ = strtoll(value.c_str(), NULL, 10);
+		else if (key == "pts")
+			resume_pts_ = strtoll(value.c_str(), NULL, 10);
+		else if (key == "timecode")
+			resume_timecode_ms_ = strtoll(value.c_str(), NULL, 10);
+	}
+
+	// Checkpoint has to match the input media & the render settings
+	if ((media != app_.settings().mediafile()) || (settings != checkpointSettings()) || (resume_pts_ == AV_NOPTS_VALUE)) {
+		log_warn("Checkpoint '%s' doesn't match, restart rendering", checkpointFilename().c_str());
+		goto failure;
+	}
+
+	segment_frame_ = frame_time_;
+
+	return true;
+
+failure:
+	segment_ = 0;
+	frame_time_ = 0;
+	resume_pts_ = AV_NOPTS_VALUE;
+	resume_timecode_ms_ = 0;
+
+	return false;
+}
+
+
+bool Renderer::saveCheckpoint(int64_t pts, int64_t timecode_ms) {
+	std::string filename = checkpointFilename();
+	std::string tmpfile = filename + ".tmp";
+
+	std::ofstream stream(tmpfile);
+
+	log_call();
+
+	if (!stream.is_open()) {
+		log_error("Open '%s' checkpoint file failure", tmpfile.c_str());
+		return false;
+	}
+
+	stream << "media=" << app_.settings().mediafile() << std::endl;
+	stream << "settings=" << checkpointSettings() << std::endl;
+	stream << "segment=" << segment_ << std::endl;
+	stream << "frame=" << frame_time_ << std::endl;
+	stream << "pts=" << pts << std::endl;
+	stream << "timecode=" << timecode_ms << std::endl;
+
+	if (!stream.fail())
+		stream.close();
+
+	// Short write (disk full...), the previous checkpoint is kept
+	if (stream.fail()) {
+		log_error("Write '%s' checkpoint file failure", tmpfile.c_str());
+		::remove(tmpfile.c_str());
+		return false;
+	}
+
+	// Atomic update
+	if (::rename(tmpfile.c_str(), filename.c_str()) != 0) {
+		log_error("Save '%s' checkpoint file failure", filename.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+
+bool Renderer::nextSegment(int64_t pts, int64_t timecode_ms) {
+	bool result = true;
+
+	log_call();
+
+	// Audio thread is paused while encoders are replaced
+	if (audio_)
+		audio_->stop();
+
+	// Close current segment of each output (trailer is written)
+	for (Output *output : outputs_) {
+		output->encoder_->close();
+	}
+
+	segment_++;
+	segment_frame_ = frame_time_;
+
+	// Segments are safe, next run can resume from here
+	if (!saveCheckpoint(pts, timecode_ms))
+		result = false;
+
+	// Open next segments
+	for (Output *output : outputs_) {
+		EncoderSettings settings = output->encoder_->settings();
+
+		delete output->encoder_;
+
+		settings.setFilename(segmentFilename(output, segment_));
+
+		output->encoder_ = Encoder::create(settings);
+
+		if (output->encoder_->open() == false)
+			result = false;
+	}
+
+	if (audio_) {
+		audio_->clear();
+
+		for (Output *output : outputs_)
+			audio_->append(output->encoder_);
+
+		audio_->start();
+	}
+
+	return result;
+}
+
+
+bool Renderer::merge(void) {
+	int i;
+
+	log_call();
+
+	log_notice("Merge %d segments...", segment_ + 1);
+
+	// Every output is merged before any segment is removed
+	for (Output *output : outputs_) {
+		std::list<std::string> filenames;
+
+		for (i=0; i<=segment_; i++)
+			filenames.push_back(segmentFilename(output, i));
+
+		if (Encoder::concat(filenames, output->filename()) == false) {
+			log_error("Merge '%s' segments failure, segments & checkpoint are kept", output->filename().c_str());
+			return false;
+		}
+	}
+
+	for (Output *output : outputs_) {
+		for (i=0; i<=segment_; i++)
+			::remove(segmentFilename(output, i).c_str());
+	}
+
+	::remove(checkpointFilename().c_str());
+
+	return true;
+}
+
+
+Renderer::Pace Renderer::pace(int64_t timecode) {
+	int64_t now;
+	int64_t lag, budget;
 
-	// Draw overlay
-	OIIO::ImageBufAlgo::over(frame_buffer, *overlay_, frame_buffer, OIIO::ROI());
+	VideoStreamPtr video_stream = container_->getVideoStream();
+
+	now = av_gettime_relative();
+	budget = (int64_t) app_.settings().live() * 1000;
 
-	// Draw each widget, map...
-	for (VideoWidget *widget : widgets_)
-		widget->render(&frame_buffer, data);
+	// First frame anchors media clock on wall clock
+	if (live_origin_ == AV_NOPTS_VALUE) {
+		live_origin_ = now;
+		live_origin_pts_ = timecode;
+	}
+
+	// Delay since frame was expected at input rate
+	lag = now - (live_origin_ + av_rescale_q(timecode - live_origin_pts_, video_stream->timeBase(), AV_TIME_BASE_Q));
+
+	// Input stall or timestamp jump, restart media clock
+	if ((lag > RENDERER_LIVE_RESYNC) || (lag < -RENDERER_LIVE_RESYNC)) {
+		log_warn("Live input discontinuity (%ld ms), resync media clock", lag / 1000);
+
+		live_origin_ = now;
+		live_origin_pts_ = timecode;
+
+		return PaceOnTime;
+	}
+
+	// Budget is already spent, frame can't be sent in time
+	if (lag > budget)
+		return PaceDrop;
+
+	// Half budget is spent, skip widgets update
+	if (lag > budget / 2)
+		return PaceLate;
+
+	return PaceOnTime;
+}
+
+
+int64_t Renderer::latency(int64_t timecode) {
+	int64_t value;
+
+	VideoStreamPtr video_stream = container_->getVideoStream();
+
+	// From expected input arrival to encoded output
+	value = av_gettime_relative() - (live_origin_ + av_rescale_q(timecode - live_origin_pts_, video_stream->timeBase(), AV_TIME_BASE_Q));
+
+	live_frames_++;
+	live_latency_sum_ += value;
+	live_latency_max_ = MAX(live_latency_max_, value);
+
+	return value;
+}
+
+
+FramePtr Renderer::render(Output *output, FramePtr frame, OIIO::ImageBuf &source, bool inplace) {
+	FramePtr result;
+
+	const VideoParams &params = frame->videoParams();
+
+	bool resize = (output->width() != params.width()) || (output->height() != params.height());
+
+	// Last output at source size is drawn in the decoded frame
+	if (inplace && !resize) {
+		if (gpx_)
+			draw(output, source, data_);
+
+		frame->fromImageBuf(source);
+
+		return frame;
+	}
+
+	// Other outputs work on a scaled (or a plain) copy
+	OIIO::ImageBuf buf(OIIO::ImageSpec(output->width(), output->height(), source.nchannels(), source.spec().format));
+
+	if (resize)
+		OIIO::ImageBufAlgo::resize(buf, source);
+	else
+		OIIO::ImageBufAlgo::copy(buf, source);
+
+	if (gpx_)
+		draw(output, buf, data_);
+
+	result = Frame::create();
+	result->setTimestamp(frame->timestamp());
+	result->setVideoParams(VideoParams(output->width(), output->height(),
+		params.format(),
+		params.nbChannels(),
+		params.pixelAspectRatio(),
+		params.interlacing()));
+	result->setData((uint8_t *) malloc(result->linesizeBytes() * output->height()));
+
+	result->fromImageBuf(buf);
+
+	return result;
+}
+
+
+void Renderer::draw(Output *output, OIIO::ImageBuf &buf, const GPXData &data) {
+	size_t i = 0;
+
+	std::list<OIIO::ImageBuf *>::iterator layer = output->layers_.begin();
+
+	// Draw each widget, map... in its own layer (late frame reuses previous layers)
+	for (VideoWidget *widget : output->widgets_) {
+		if (!refresh_)
+			break;
+
+		OIIO::ImageBuf *layer_buf = *layer++;
+
+		uint64_t key = hashData(&sample_, sizeof(sample_), output->keys_[i]);
+		uint64_t &content = output->contents_[i++];
+
+		// Widget out of frame
+		if (layer_buf == NULL)
+			continue;
+
+		// Layer already holds this content (same sample as previous frame)
+		if (content == key)
+			continue;
+
+		content = key;
+
+		// Rendered by a previous run
+		if (overlay_cache_ && overlay_cache_->load(key, layer_buf))
+			continue;
+
+		OIIO::ImageBufAlgo::zero(*layer_buf);
+
+		widget->render(layer_buf, data);
+
+		if (overlay_cache_)
+			overlay_cache_->save(key, layer_buf);
+	}
 
-	frame->fromImageBuf(frame_buffer);
+	// Blend overlay & layers in a single pass
+	output->compositor_->compose(buf);
 }
 
 
@@ -19,25 +19,74 @@
 #include "media.h"
 #include "decoder.h"
 #include "encoder.h"
+#include "compositor.h"
+#include "audiopipeline.h"
+#include "overlaycache.h"
+#include "renderersettings.h"
 #include "videowidget.h"
 #include "gpx2video.h"
 
 
+// Live mode, lag (in us) considered as an input discontinuity
+#define RENDERER_LIVE_RESYNC (2 * AV_TIME_BASE)
+
+
 class Renderer : public GPX2Video::Task {
 public:
+	// An output (layout, size & encoder) fed by the shared decode
+	class Output {
+	public:
+		Output(const RendererSettings &settings);
+		virtual ~Output();
+
+		const RendererSettings& settings(void) const;
+
+		const int& width(void) const;
+		const int& height(void) const;
+
+		std::string filename(void) const;
+
+	private:
+		friend class Renderer;
+
+		RendererSettings settings_;
+
+		int width_, height_;
+
+		Encoder *encoder_;
+
+		std::list<VideoWidget *> widgets_;
+
+		OIIO::ImageBuf *overlay_;
+
+		Compositor *compositor_;
+		std::list<OIIO::ImageBuf *> layers_;
+
+		// Per widget layer key & key of the content held by its layer
+		std::vector<uint64_t> keys_;
+		std::vector<uint64_t> contents_;
+	};
+
 	virtual ~Renderer();
 
 	static Renderer * create(GPX2Video &app); //, Map *map=NULL);
 
-	void append(VideoWidget *widget);
+	void append(Output *output, VideoWidget *widget);
 
 	bool start(void);
 	bool run(void);
 	bool stop(void);
 
-	void draw(FramePtr frame, const GPXData &data);
+	void draw(Output *output, OIIO::ImageBuf &buf, const GPXData &data);
 
 private:
+	// Live mode, what to do with a frame according to its deadline
+	enum Pace {
+		PaceOnTime,
+		PaceLate,
+		PaceDrop
+	};
+
 	GPX2Video &app_;
 
 	GPX *gpx_;
@@ -46,11 +95,14 @@ private:
 	MediaContainer *container_;
 	Decoder *decoder_audio_;
 	Decoder *decoder_video_;
-	Encoder *encoder_;
 
-	std::list<VideoWidget *> widgets_;
+	AudioPipeline *audio_;
 
-	OIIO::ImageBuf *overlay_;
+	// Rendered layers cache (a layer is keyed by its widget & telemetry sample)
+	OverlayCache *overlay_cache_;
+	uint64_t sample_;
+
+	std::list<Output *> outputs_;
 
 	time_t started_at_;
 
@@ -59,14 +111,44 @@ private:
 
 	int64_t frame_time_ = 0;
 
+	// Resumable render
+	bool finished_;
+	int segment_;
+	int64_t segment_frame_;
+	int64_t resume_pts_;
+	int64_t resume_timecode_ms_;
+
+	// Live mode
+	bool refresh_;
+	int64_t live_origin_;
+	int64_t live_origin_pts_;
+	int64_t live_frames_;
+	int64_t live_degraded_;
+	int64_t live_dropped_;
+	int64_t live_latency_sum_;
+	int64_t live_latency_max_;
+
 	Renderer(GPX2Video &app); //, Map *map);
 
 	void init(void);
-	bool load(void);
-	bool loadMap(layout::Map *m);
-	bool loadTrack(layout::Track *t);
-	bool loadWidget(layout::Widget *w);
-	void computeWidgetsPosition(void);
+	bool load(Output *output);
+	bool loadMap(Output *output, layout::Map *m);
+	bool loadTrack(Output *output, layout::Track *t);
+	bool loadWidget(Output *output, layout::Widget *w);
+	void computeWidgetsPosition(Output *output);
+
+	Pace pace(int64_t timecode);
+	int64_t latency(int64_t timecode);
+
+	FramePtr render(Output *output, FramePtr frame, OIIO::ImageBuf &source, bool inplace);
+
+	std::string segmentFilename(Output *output, int segment);
+	std::string checkpointFilename(void);
+	std::string checkpointSettings(void);
+	bool loadCheckpoint(void);
+	bool saveCheckpoint(int64_t pts, int64_t timecode_ms);
+	bool nextSegment(int64_t pts, int64_t timecode_ms);
+	bool merge(void);
 
 	void add(OIIO::ImageBuf *frame, int x, int y, const char *picto, const char *label, const char *value, double divider=1.9);
 };
@@ -0,0 +1,44 @@
+#ifndef __GPX2VIDEO__RENDERERSETTINGS_H__
+#define __GPX2VIDEO__RENDERERSETTINGS_H__
+
+#include <iostream>
+#include <string>
+
+
+class RendererSettings {
+public:
+	RendererSettings();
+	virtual ~RendererSettings();
+
+	const std::string& layoutfile(void) const;
+	void setLayoutfile(const std::string &layoutfile);
+
+	const std::string& outputfile(void) const;
+	void setOutputfile(const std::string &outputfile);
+
+	// Output size (0 keeps source size)
+	const int& width(void) const;
+	const int& height(void) const;
+	void setSize(const int &width, const int &height);
+
+	// Video bitrate (in kbps, 0 keeps default)
+	const int& bitrate(void) const;
+	void setBitrate(const int &bitrate);
+
+	// x264 preset (empty keeps default)
+	const std::string& preset(void) const;
+	void setPreset(const std::string &preset);
+
+	static bool parse(const std::string &s, RendererSettings &settings);
+
+private:
+	std::string layout_file_;
+	std::string output_file_;
+
+	int width_, height_;
+
+	int bitrate_;
+	std::string preset_;
+};
+
+#endif
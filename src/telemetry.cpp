@@ -36,6 +36,8 @@ const std::string TelemetrySettings::getFriendlyName(const TelemetrySettings::Fi
 		return "Apply a simple linear filter on GPX data";
 	case FilterInterpolate:
 		return "Interpolate GPX data filter";
+	case FilterSmooth:
+		return "Smooth GPX data over the whole track (forward-backward Kalman)";
 	case FilterCount:
 	default:
 		return "";
@@ -13,6 +13,7 @@ public:
 		FilterKalman,
 		FilterLinear,
 		FilterInterpolate,
+		FilterSmooth,
 
 		FilterCount
 	};
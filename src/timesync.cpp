@@ -8,6 +8,7 @@ extern "C" {
 }
 
 #include "log.h"
+#include "datetime.h"
 #include "timesync.h"
 
 
@@ -74,7 +75,7 @@ bool TimeSync::run(void) {
 	int start_time = 0;
 
 	time_t gps_t;
-	struct tm gps_time;
+	int64_t gps_ms;
 
 	time_t camera_t;
 	struct tm camera_time;
@@ -122,10 +123,10 @@ bool TimeSync::run(void) {
 	// GPS time - format = 2021-12-08 08:55:46.039
 	str = gpmd.date.c_str();
 
-	memset(&gps_time, 0, sizeof(gps_time));
-	strptime(str, "%Y-%m-%d %H:%M:%S.", &gps_time);
+	if (!::parse_datetime_ms(str, &gps_ms))
+		gps_ms = 0;
 
-	gps_t = timegm(&gps_time);
+	gps_t = gps_ms / 1000;
 
 	// Offset in seconds
 	offset = gps_t - camera_t;
@@ -9,6 +9,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <math.h>
+#include <float.h>
 
 #include <OpenImageIO/imageio.h>
 #include <OpenImageIO/imagebuf.h>
@@ -89,6 +90,10 @@ void TrackSettings::setBoundingBox(double lat1, double lon1, double lat2, double
 }
 
 
+std::mutex Track::lod_mutex_;
+std::map<std::pair<const GPXStore *, int>, Track::LevelOfDetailEntry> Track::lods_;
+
+
 Track::Track(GPX2Video &app, const TrackSettings &settings, struct event_base *evbase)
 	: VideoWidget(app, "map")
 	, app_(app)
@@ -251,6 +256,103 @@ void Track::init(bool zoomfit) {
 }
 
 
+// Distance from point i to the [a, b] segment
+static double deviation(const std::vector<int> &x, const std::vector<int> &y, size_t a, size_t b, size_t i) {
+	double dx = x[b] - x[a];
+	double dy = y[b] - y[a];
+	double px = x[i] - x[a];
+	double py = y[i] - y[a];
+	double l = dx * dx + dy * dy;
+	double t = (l > 0) ? std::min(std::max((px * dx + py * dy) / l, 0.0), 1.0) : 0.0;
+
+	return hypot(px - t * dx, py - t * dy);
+}
+
+
+std::shared_ptr<const Track::LevelOfDetail> Track::levelOfDetail(std::shared_ptr<const GPXStore> store, int zoom) {
+	size_t i, n = store->size();
+
+	std::map<std::pair<const GPXStore *, int>, LevelOfDetailEntry>::iterator iter;
+
+	std::lock_guard<std::mutex> lock(lod_mutex_);
+
+	// Drop levels of released tracks (a new track may get the same address)
+	for (iter = lods_.begin(); iter != lods_.end(); ) {
+		if (iter->second.store.expired())
+			iter = lods_.erase(iter);
+		else
+			++iter;
+	}
+
+	LevelOfDetailEntry &entry = lods_[std::make_pair(store.get(), zoom)];
+
+	if (entry.lod != NULL)
+		return entry.lod;
+
+	log_call();
+
+	std::shared_ptr<LevelOfDetail> lod = std::make_shared<LevelOfDetail>();
+
+	lod->x.resize(n);
+	lod->y.resize(n);
+	lod->significance.assign(n, 0.0);
+
+	// Projection, once per zoom
+	for (i=0; i<n; i++) {
+		lod->x[i] = Track::lon2pixel(zoom, store->lon(i));
+		lod->y[i] = Track::lat2pixel(zoom, store->lat(i));
+	}
+
+	if (n > 0) {
+		lod->significance[0] = FLT_MAX;
+		lod->significance[n - 1] = FLT_MAX;
+	}
+
+	// Douglas-Peucker: a point splitting a range is at most as significant
+	// as the point which split its parent range, so that keeping points above
+	// a tolerance gives the simplified polyline at this tolerance.
+	struct Range {
+		size_t a, b;
+		float parent;
+	};
+
+	std::vector<Range> stack;
+
+	if (n > 2)
+		stack.push_back({ 0, n - 1, FLT_MAX });
+
+	while (!stack.empty()) {
+		Range range = stack.back();
+
+		size_t m = range.a;
+		double d, dmax = -1.0;
+
+		stack.pop_back();
+
+		for (i=range.a+1; i<range.b; i++) {
+			d = deviation(lod->x, lod->y, range.a, range.b, i);
+
+			if (d > dmax) {
+				dmax = d;
+				m = i;
+			}
+		}
+
+		lod->significance[m] = std::min((float) dmax, range.parent);
+
+		if (m - range.a > 1)
+			stack.push_back({ range.a, m, lod->significance[m] });
+		if (range.b - m > 1)
+			stack.push_back({ m, range.b, lod->significance[m] });
+	}
+
+	entry.store = store;
+	entry.lod = lod;
+
+	return entry.lod;
+}
+
+
 void Track::path(OIIO::ImageBuf &outbuf, GPX *gpx, double divider) {
 	int zoom;
 	int stride;
@@ -258,12 +360,38 @@ void Track::path(OIIO::ImageBuf &outbuf, GPX *gpx, double divider) {
 
 	int x = 0, y = 0;
 
-	GPXData wpt;
+	size_t i, first, last;
+
+	double tolerance;
+
+	std::vector<std::pair<int, int> > points;
 
 	log_call();
 
 	zoom = settings().zoom();
 
+	gpx->range(&first, &last);
+
+	// Points visible at this zoom & divider (tolerance in zoom pixels)
+	std::shared_ptr<const LevelOfDetail> lod = levelOfDetail(gpx->sharedStore(), zoom);
+
+	tolerance = TRACK_PATH_TOLERANCE / divider;
+
+	for (i=first; i<last; i++) {
+		if ((i != first) && (i != last - 1) && (lod->significance[i] <= tolerance))
+			continue;
+
+		x = lod->x[i] - (x1_ * TILESIZE);
+		y = lod->y[i] - (y1_ * TILESIZE);
+
+		x *= divider;
+		y *= divider;
+
+		points.push_back(std::make_pair(x, y));
+	}
+
+	log_debug("Track path: %lu points drawn out of %lu", (unsigned long) points.size(), (unsigned long) (last - first));
+
 	// Cairo buffer
 	OIIO::ImageBuf buf(outbuf.spec());
 
@@ -279,15 +407,8 @@ void Track::path(OIIO::ImageBuf &outbuf, GPX *gpx, double divider) {
 	cairo_set_line_join(cairo, CAIRO_LINE_JOIN_ROUND);
 
 	// Draw each WPT
-	for (gpx->retrieveFirst(wpt); wpt.valid(); gpx->retrieveNext(wpt)) {
-		x = floorf((float) Track::lon2pixel(zoom, wpt.position().lon)) - (x1_ * TILESIZE);
-		y = floorf((float) Track::lat2pixel(zoom, wpt.position().lat)) - (y1_ * TILESIZE);
-
-		x *= divider;
-		y *= divider;
-
-		cairo_line_to(cairo, x, y);
-	}
+	for (const std::pair<int, int> &point : points)
+		cairo_line_to(cairo, point.first, point.second);
 
 	// Cairo draw
 	cairo_stroke(cairo);
@@ -298,15 +419,8 @@ void Track::path(OIIO::ImageBuf &outbuf, GPX *gpx, double divider) {
 	cairo_set_line_join(cairo, CAIRO_LINE_JOIN_ROUND);
 
 	// Draw each WPT
-	for (gpx->retrieveFirst(wpt); wpt.valid(); gpx->retrieveNext(wpt)) {
-		x = floorf((float) Track::lon2pixel(zoom, wpt.position().lon)) - (x1_ * TILESIZE);
-		y = floorf((float) Track::lat2pixel(zoom, wpt.position().lat)) - (y1_ * TILESIZE);
-
-		x *= divider;
-		y *= divider;
-
-		cairo_line_to(cairo, x, y);
-	}
+	for (const std::pair<int, int> &point : points)
+		cairo_line_to(cairo, point.first, point.second);
 
 	// Cairo draw
 	cairo_stroke (cairo);
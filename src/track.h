@@ -7,6 +7,9 @@
 #include <cstdio>
 #include <cstdlib>
 #include <list>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #include <stdlib.h>
 
@@ -21,6 +24,10 @@
 #include "gpx2video.h"
 
 
+// Max distance (in output pixels) between the drawn path and the track points
+#define TRACK_PATH_TOLERANCE 0.5
+
+
 class Track : public VideoWidget {
 public:
 	virtual ~Track();
@@ -42,6 +49,18 @@ public:
 	void render(OIIO::ImageBuf *frame, const GPXData &data);
 
 protected:
+	/**
+	 * Level of detail of a track at one zoom: pixel position of each point
+	 * and its Douglas-Peucker significance (the tolerance up to which the point
+	 * is kept). Any tolerance is then a single filter pass over the points.
+	 */
+	struct LevelOfDetail {
+		std::vector<int> x, y;
+		std::vector<float> significance;
+	};
+
+	static std::shared_ptr<const LevelOfDetail> levelOfDetail(std::shared_ptr<const GPXStore> store, int zoom);
+
 	OIIO::ImageBuf *buf_;
 
 	Track(GPX2Video &app, const TrackSettings &settings, struct event_base *evbase);
@@ -67,6 +86,17 @@ protected:
 	// Start & end position
 	int x_end_, y_end_;
 	int x_start_, y_start_;
+
+private:
+	// Levels of detail by track & zoom (shared by track & map widgets), the
+	// weak pointer tells if the track is still the one at this address
+	struct LevelOfDetailEntry {
+		std::weak_ptr<const GPXStore> store;
+		std::shared_ptr<const LevelOfDetail> lod;
+	};
+
+	static std::mutex lod_mutex_;
+	static std::map<std::pair<const GPXStore *, int>, LevelOfDetailEntry> lods_;
 };
 
 #endif
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <fstream>
 #include <string>
 
 #include <string.h>
@@ -105,3 +106,37 @@ void rmpath(std::string path) {
 
 	::remove(path.c_str());
 }
+
+
+uint64_t hashData(const void *data, size_t size, uint64_t seed) {
+	size_t i;
+
+	const uint8_t *p = (const uint8_t *) data;
+
+	for (i=0; i<size; i++) {
+		seed ^= p[i];
+		seed *= HASH_PRIME;
+	}
+
+	return seed;
+}
+
+
+uint64_t hashData(const std::string &s, uint64_t seed) {
+	return hashData(s.data(), s.size(), seed);
+}
+
+
+uint64_t hashFile(const std::string &filename, uint64_t seed) {
+	char buf[64 * 1024];
+
+	std::ifstream stream(filename, std::ios::binary);
+
+	if (!stream.is_open())
+		return hashData(filename, seed);
+
+	while (stream.read(buf, sizeof(buf)) || (stream.gcount() > 0))
+		seed = hashData(buf, stream.gcount(), seed);
+
+	return seed;
+}
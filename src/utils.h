@@ -3,6 +3,14 @@
 
 #include <string>
 
+#include <stdint.h>
+#include <sys/types.h>
+
+
+// FNV-1a 64 bits
+#define HASH_SEED 0xcbf29ce484222325ULL
+#define HASH_PRIME 0x100000001b3ULL
+
 
 std::string replace(
 		std::string sHaystack, std::string sNeedle, std::string sReplace,
@@ -12,5 +20,10 @@ int mkpath(std::string &path, mode_t mode);
 
 void rmpath(std:: string path);
 
+// Cache keys (not cryptographic)
+uint64_t hashData(const void *data, size_t size, uint64_t seed=HASH_SEED);
+uint64_t hashData(const std::string &s, uint64_t seed=HASH_SEED);
+uint64_t hashFile(const std::string &filename, uint64_t seed=HASH_SEED);
+
 #endif
 
@@ -0,0 +1,113 @@
+/**
+ * Compare parse_datetime_ms with the strptime / timegm parser it replaces.
+ *
+ * Usage: datetime-bench [iterations]
+ */
+#include <chrono>
+#include <vector>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "src/datetime.h"
+
+
+static bool parse_strptime(const char *s, int64_t *time_ms) {
+	struct tm time;
+
+	// Formats & order as in the previous GPX reader
+	memset(&time, 0, sizeof(time));
+	if (strptime(s, "%Y:%m:%d %H:%M:%S.", &time) != NULL)
+		goto done;
+	memset(&time, 0, sizeof(time));
+	if (strptime(s, "%Y-%m-%dT%H:%M:%S.", &time) != NULL)
+		goto done;
+	memset(&time, 0, sizeof(time));
+	if (strptime(s, "%Y-%m-%dT%H:%M:%SZ", &time) != NULL)
+		goto done;
+
+	return false;
+
+done:
+	*time_ms = ((int64_t) timegm(&time)) * 1000;
+
+	return true;
+}
+
+
+int main(int argc, char *argv[]) {
+	size_t i, n;
+	int iterations = 200;
+
+	int64_t t1, t2;
+	int64_t sum1 = 0, sum2 = 0;
+
+	std::vector<std::string> dates;
+
+	if (argc > 1)
+		iterations = atoi(argv[1]);
+
+	// One day of 1 Hz points in each format
+	for (i=0; i<86400; i++) {
+		char s[64];
+
+		int h = i / 3600, m = (i / 60) % 60, sec = i % 60;
+
+		switch (i % 3) {
+		case 0:
+			snprintf(s, sizeof(s), "2020-07-28T%02d:%02d:%02d.000Z", h, m, sec);
+			break;
+		case 1:
+			snprintf(s, sizeof(s), "2020-07-28T%02d:%02d:%02dZ", h, m, sec);
+			break;
+		default:
+			snprintf(s, sizeof(s), "2020:12:13 %02d:%02d:%02d.215", h, m, sec);
+			break;
+		}
+
+		dates.push_back(s);
+	}
+
+	n = dates.size();
+
+	// Check both parsers agree (strptime path drops the ms)
+	for (i=0; i<n; i++) {
+		if (!parse_strptime(dates[i].c_str(), &t1) || !parse_datetime_ms(dates[i].c_str(), &t2)
+				|| (t1 != (t2 - (t2 % 1000)))) {
+			printf("Mismatch on '%s': %lld != %lld\n", dates[i].c_str(), (long long) t1, (long long) t2);
+			return 1;
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (int it=0; it<iterations; it++) {
+		for (i=0; i<n; i++) {
+			parse_strptime(dates[i].c_str(), &t1);
+			sum1 += t1;
+		}
+	}
+
+	auto middle = std::chrono::steady_clock::now();
+
+	for (int it=0; it<iterations; it++) {
+		for (i=0; i<n; i++) {
+			parse_datetime_ms(dates[i].c_str(), &t2);
+			sum2 += t2;
+		}
+	}
+
+	auto end = std::chrono::steady_clock::now();
+
+	double d1 = std::chrono::duration<double, std::nano>(middle - start).count() / (iterations * n);
+	double d2 = std::chrono::duration<double, std::nano>(end - middle).count() / (iterations * n);
+
+	printf("strptime/timegm   : %8.1f ns/date (%lld)\n", d1, (long long) sum1);
+	printf("parse_datetime_ms : %8.1f ns/date (%lld)\n", d2, (long long) sum2);
+	printf("speedup           : %8.1fx\n", d1 / d2);
+
+	return 0;
+}
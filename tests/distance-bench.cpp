@@ -0,0 +1,84 @@
+/**
+ * Compare the distance engine with a GeographicLib solver built per call.
+ *
+ * Usage: distance-bench [points]
+ */
+#include <chrono>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <GeographicLib/Geodesic.hpp>
+
+#include "src/distance.h"
+
+
+int main(int argc, char *argv[]) {
+	size_t i, n = 1000000;
+
+	double maxerr = 0.0;
+	double sum1 = 0.0, sum2 = 0.0, sum3 = 0.0, sum4 = 0.0;
+
+	if (argc > 1)
+		n = atol(argv[1]);
+
+	std::vector<double> lat(n), lon(n);
+	std::vector<double> d1(n, 0.0), d2(n, 0.0), d3(n, 0.0), d4(n, 0.0);
+
+	// 1 Hz ride, ~10 m between points
+	lat[0] = 45.18;
+	lon[0] = 5.72;
+
+	for (i=1; i<n; i++) {
+		lat[i] = lat[i-1] + ((rand() % 2001) - 1000) * 1e-7;
+		lon[i] = lon[i-1] + ((rand() % 2001) - 1000) * 1e-7;
+	}
+
+	// Previous code: a new solver for each segment
+	auto t0 = std::chrono::steady_clock::now();
+
+	for (i=1; i<n; i++) {
+		GeographicLib::Geodesic gsic(6378388, 1/297.0);
+		gsic.Inverse(lat[i-1], lon[i-1], lat[i], lon[i], d1[i]);
+	}
+
+	auto t1 = std::chrono::steady_clock::now();
+
+	Distance::segments(lat.data(), lon.data(), n, d2.data(), Distance::AccuracyGeodesic);
+
+	auto t2 = std::chrono::steady_clock::now();
+
+	Distance::segments(lat.data(), lon.data(), n, d3.data(), Distance::AccuracyHaversine);
+
+	auto t3 = std::chrono::steady_clock::now();
+
+	// Single segment API (widgets, filters)
+	for (i=1; i<n; i++)
+		d4[i] = Distance::compute(lat[i-1], lon[i-1], lat[i], lon[i], Distance::AccuracyHaversine);
+
+	auto t4 = std::chrono::steady_clock::now();
+
+	for (i=1; i<n; i++) {
+		sum1 += d1[i];
+		sum2 += d2[i];
+		sum3 += d3[i];
+		sum4 += d4[i];
+
+		if (d1[i] > 1.0)
+			maxerr = std::max(maxerr, fabs(d3[i] - d1[i]) / d1[i]);
+	}
+
+	auto ns = [&](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+		return std::chrono::duration<double, std::nano>(b - a).count() / (n - 1);
+	};
+
+	printf("geodesic, solver per call : %8.1f ns/segment, total %.3f km\n", ns(t0, t1), sum1 / 1000.0);
+	printf("geodesic, cached solver   : %8.1f ns/segment, total %.3f km\n", ns(t1, t2), sum2 / 1000.0);
+	printf("haversine, batch kernel   : %8.1f ns/segment, total %.3f km (max error %.3f%%)\n",
+		ns(t2, t3), sum3 / 1000.0, maxerr * 100.0);
+	printf("haversine, per call       : %8.1f ns/segment, total %.3f km\n", ns(t3, t4), sum4 / 1000.0);
+
+	return 0;
+}